@@ -0,0 +1,156 @@
+#include <cmath>
+#include <algorithm>
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apfShape.h>
+#include <ma.h>
+#include <PCU.h>
+
+#include "goal_adapt.hpp"
+#include "goal_balance.hpp"
+#include "goal_control.hpp"
+#include "goal_disc.hpp"
+
+namespace goal {
+
+static ParameterList get_valid_params() {
+  ParameterList p;
+  p.set<double>("target error", 0.0);
+  p.set<int>("max cycles", 0);
+  p.set<bool>("balance", false);
+  return p;
+}
+
+Adapt::Adapt(ParameterList const& p, Disc* d) :
+    params(p),
+    disc(d),
+    error(0),
+    target(0.0),
+    max_cycles(1),
+    should_balance(false) {
+  params.validateParameters(get_valid_params(), 0);
+  target = params.get<double>("target error");
+  if (params.isParameter("max cycles"))
+    max_cycles = params.get<int>("max cycles");
+  if (params.isParameter("balance"))
+    should_balance = params.get<bool>("balance");
+}
+
+Adapt::~Adapt() {
+  if (error) apf::destroyField(error);
+}
+
+apf::Field* Adapt::get_error_field() {
+  if (error) return error;
+  auto m = disc->get_apf_mesh();
+  auto s = apf::getConstant(m->getDimension());
+  error = apf::createField(m, "error", apf::SCALAR, s);
+  return error;
+}
+
+bool Adapt::is_done(const int cycle, const double err) {
+  print("**** adapt cycle %d: error %.15e target %.15e",
+      cycle, err, target);
+  return (err < target) || (cycle >= max_cycles);
+}
+
+static double get_elem_size(apf::Mesh* m, apf::MeshEntity* elem) {
+  apf::Downward edges;
+  int nedges = m->getDownward(elem, 1, edges);
+  double h = 0.0;
+  for (int e = 0; e < nedges; ++e)
+    h += apf::measure(m, edges[e]);
+  return h / nedges;
+}
+
+static void reduce_min(apf::Mesh* m, apf::Field* size) {
+  PCU_Comm_Begin();
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = m->begin(0);
+  while ((vtx = m->iterate(vertices))) {
+    if (! m->isShared(vtx)) continue;
+    double h = apf::getScalar(size, vtx, 0);
+    apf::Copies remotes;
+    m->getRemotes(vtx, remotes);
+    APF_ITERATE(apf::Copies, remotes, it) {
+      PCU_COMM_PACK(it->first, it->second);
+      PCU_COMM_PACK(it->first, h);
+    }
+  }
+  m->end(vertices);
+  PCU_Comm_Send();
+  while (PCU_Comm_Receive()) {
+    apf::MeshEntity* remote;
+    double h;
+    PCU_COMM_UNPACK(remote);
+    PCU_COMM_UNPACK(h);
+    if (h < apf::getScalar(size, remote, 0))
+      apf::setScalar(size, remote, 0, h);
+  }
+}
+
+static apf::Field* get_size_field(
+    apf::Mesh2* m,
+    apf::Field* e,
+    const double target) {
+  int dim = m->getDimension();
+  long nelems = PCU_Add_Long(m->count(dim));
+  double eta_t = target / nelems;
+  double p = 1.0 / (2.0 + dim);
+  auto elem_size = apf::createField(
+      m, "elem_size", apf::SCALAR, apf::getConstant(dim));
+  apf::MeshEntity* elem;
+  apf::MeshIterator* elems = m->begin(dim);
+  while ((elem = m->iterate(elems))) {
+    double eta = apf::getScalar(e, elem, 0);
+    double ratio = (eta > 0.0) ? std::pow(eta_t / eta, p) : 2.0;
+    ratio = std::min(2.0, std::max(0.25, ratio));
+    double h = get_elem_size(m, elem) * ratio;
+    apf::setScalar(elem_size, elem, 0, h);
+  }
+  m->end(elems);
+  auto size = apf::createFieldOn(m, "size", apf::SCALAR);
+  apf::Adjacent up;
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = m->begin(0);
+  while ((vtx = m->iterate(vertices))) {
+    m->getAdjacent(vtx, dim, up);
+    double h = apf::getScalar(elem_size, up[0], 0);
+    for (size_t i = 1; i < up.getSize(); ++i)
+      h = std::min(h, apf::getScalar(elem_size, up[i], 0));
+    apf::setScalar(size, vtx, 0, h);
+  }
+  m->end(vertices);
+  apf::destroyField(elem_size);
+  reduce_min(m, size);
+  return size;
+}
+
+void Adapt::adapt() {
+  GOAL_DEBUG_ASSERT(error);
+  GOAL_DEBUG_ASSERT(! disc->has_data());
+  auto t0 = time();
+  auto m = disc->get_apf_mesh();
+  auto size = get_size_field(m, error, target);
+  apf::destroyField(error);
+  error = 0;
+  disc->mesh_changed();
+  auto in = ma::configure(m, size);
+  ma::adapt(in);
+  apf::destroyField(size);
+  if (should_balance) balance(m);
+  apf::reorderMdsMesh(m);
+  auto t1 = time();
+  print(" > mesh adapted in %f seconds", t1 - t0);
+}
+
+Adapt* create_adapt(ParameterList const& p, Disc* d) {
+  return new Adapt(p, d);
+}
+
+void destroy_adapt(Adapt* a) {
+  delete a;
+}
+
+}
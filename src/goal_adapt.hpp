@@ -0,0 +1,37 @@
+#ifndef goal_adapt_hpp
+#define goal_adapt_hpp
+
+#include <Teuchos_ParameterList.hpp>
+
+namespace apf {
+class Field;
+}
+
+namespace goal {
+
+using Teuchos::ParameterList;
+
+class Disc;
+
+class Adapt {
+  public:
+    Adapt(ParameterList const& p, Disc* d);
+    ~Adapt();
+    apf::Field* get_error_field();
+    bool is_done(const int cycle, const double err);
+    void adapt();
+  private:
+    ParameterList params;
+    Disc* disc;
+    apf::Field* error;
+    double target;
+    int max_cycles;
+    bool should_balance;
+};
+
+Adapt* create_adapt(ParameterList const& p, Disc* d);
+void destroy_adapt(Adapt* a);
+
+}
+
+#endif
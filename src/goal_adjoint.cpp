@@ -1,26 +1,31 @@
+#include <cmath>
 #include <apf.h>
 #include <apfMesh2.h>
+#include <apfShape.h>
 
 #include "goal_assembly.hpp"
 #include "goal_adjoint.hpp"
 #include "goal_control.hpp"
 #include "goal_dbcs.hpp"
 #include "goal_eval_modes.hpp"
+#include "goal_functional.hpp"
+#include "goal_indicator.hpp"
 #include "goal_linear_solve.hpp"
 #include "goal_poisson.hpp"
 #include "goal_nested.hpp"
+#include "goal_patch.hpp"
 #include "goal_primal.hpp"
 #include "goal_sol_info.hpp"
 #include "goal_soln.hpp"
+#include "goal_soln_adjoint.hpp"
 #include "goal_weight.hpp"
 
 namespace goal {
 
 using Teuchos::rcp;
 
-static void make_soln(Disc* d, Evaluators& a) {
-  auto m = d->get_apf_mesh();
-  auto f = m->findField("u");
+static void make_soln(Poisson* poisson, Evaluators& a) {
+  auto f = poisson->get_soln();
   GOAL_DEBUG_ASSERT(f);
   auto p = rcp(new Soln<FADT>(f, ADJOINT));
   auto w = rcp(new Weight(f));
@@ -34,30 +39,146 @@ static int get_mode(ParameterList const& p) {
   if (m == "full") mode = FULL;
   else if (m == "long") mode = LONG;
   else if (m == "single") mode = SINGLE;
+  else if (m == "quadratic") mode = QUADRATIC;
   else fail("unkown nested mode: %s", m.c_str());
   return mode;
 }
 
+enum Guess { ZERO, PROLONGATED };
+
+static int get_guess(ParameterList const& p) {
+  if (! p.isParameter("adjoint initial guess")) return ZERO;
+  int guess = ZERO;
+  auto g = p.get<std::string>("adjoint initial guess");
+  if (g == "zero") guess = ZERO;
+  else if (g == "prolongated") guess = PROLONGATED;
+  else fail("unknown adjoint initial guess: %s", g.c_str());
+  return guess;
+}
+
+static bool get_overlap(ParameterList const& p) {
+  if (! p.isParameter("adjoint overlap")) return false;
+  if (! p.get<bool>("adjoint overlap")) return false;
+  if (p.isParameter("adjoint balance") && p.get<bool>("adjoint balance"))
+    fail("adjoint overlap cannot be used with adjoint balance");
+  int level;
+  MPI_Query_thread(&level);
+  if (level >= MPI_THREAD_MULTIPLE) return true;
+  print(" > MPI_THREAD_MULTIPLE unavailable, disabling adjoint overlap");
+  return false;
+}
+
 Adjoint::Adjoint(ParameterList const& p, Primal* pr) {
   params = p;
   primal = pr;
-  auto mode = get_mode(params);
+  patch = (params.get<std::string>("adjoint mode") == "patch");
+  mode = patch ? -1 : get_mode(params);
+  guess = get_guess(params);
+  overlap = (patch || mode == QUADRATIC) ? false : get_overlap(params);
+  nested_disc = 0;
+  num_builds = 0;
+  base_linear_solver = 0;
   base_disc = primal->get_poisson()->get_disc();
-  nested_disc = create_nested(base_disc, mode);
-  auto poisson_params = params.sublist("poisson");
   auto func_params = params.sublist("functional");
+  num_qois = get_functional_params(func_params).size();
+  auto lp = params.sublist("adjoint linear algebra");
+  linear_solver = create_linear_solver(lp);
+  if (patch || guess == PROLONGATED) build_base_adjoint();
+}
+
+Adjoint::~Adjoint() {
+  if (nested_disc) wait_nested();
+  if (nested_disc) destroy_nested_data();
+  if (base_linear_solver) destroy_linear_solver(base_linear_solver);
+  destroy_linear_solver(linear_solver);
+}
+
+void Adjoint::build_nested() {
+  bool balance = false;
+  if (params.isParameter("adjoint balance"))
+    balance = params.get<bool>("adjoint balance");
+  nested_disc = create_nested(base_disc, mode, balance);
+  ++num_builds;
+  finish_nested();
+}
+
+void Adjoint::finish_nested() {
+  auto poisson_params = params.sublist("poisson");
+  auto fps = get_functional_params(params.sublist("functional"));
   poisson = create_poisson(poisson_params, nested_disc);
   nested_disc->build_data();
-  sol_info = create_sol_info(nested_disc);
-  make_soln(nested_disc, adjoint);
+  sol_info = create_sol_info(nested_disc, num_qois);
+  make_soln(poisson, adjoint);
   poisson->build_resid<FADT>(adjoint);
-  poisson->build_functional<FADT>(func_params, adjoint);
+  for (int i = 0; i < num_qois; ++i)
+    poisson->build_functional<FADT>(fps[i], adjoint, i);
 }
 
-Adjoint::~Adjoint() {
+/* the helper thread only runs Nested::refine, which works on the
+   nested mesh copy through apf/ma/PCU. until wait_nested joins it, the
+   main thread only makes local PCU calls (PCU_Comm_Self and PCU_Time
+   from print and time) and no PCU messaging or collectives. */
+
+void Adjoint::start_nested() {
+  auto comm = Tpetra::DefaultPlatform::getDefaultPlatform().getComm();
+  nested_disc = create_unrefined_nested(base_disc, mode, comm->duplicate());
+  ++num_builds;
+  print(" > refining nested mesh on a helper thread");
+  builder = std::thread(&Nested::refine, nested_disc);
+}
+
+void Adjoint::wait_nested() {
+  if (patch) return;
+  if (builder.joinable()) {
+    builder.join();
+    finish_nested();
+  }
+  if (Teuchos::nonnull(P)) return;
+  if (linear_solver->is_geometric() || guess == PROLONGATED)
+    build_prolongation();
+}
+
+void Adjoint::destroy_nested_data() {
+  adjoint.clear();
+  P = Teuchos::null;
+  linear_solver->set_prolongation(P);
+  linear_solver->reset();
   destroy_sol_info(sol_info);
   destroy_poisson(poisson);
   destroy_nested(nested_disc);
+  nested_disc = 0;
+}
+
+void Adjoint::prepare() {
+  if (patch) return;
+  if (nested_disc && ! nested_disc->is_stale(base_disc)) {
+    print(" > base mesh unchanged, reusing nested mesh");
+    return;
+  }
+  if (nested_disc) {
+    print(" > base mesh changed, rebuilding nested mesh");
+    destroy_nested_data();
+  }
+  if (overlap) start_nested();
+  else build_nested();
+}
+
+void Adjoint::release_base() {
+  if (! nested_disc) return;
+  wait_nested();
+  if (mode == QUADRATIC) destroy_nested_data();
+  else nested_disc->release_adjoint_fields();
+}
+
+void Adjoint::build_prolongation() {
+  auto t0 = time();
+  bool has_data = base_disc->has_data();
+  if (! has_data) base_disc->build_data();
+  P = nested_disc->build_prolongation(base_disc);
+  linear_solver->set_prolongation(P);
+  if (! has_data) base_disc->destroy_data();
+  auto t1 = time();
+  print(" > prolongation built in %f seconds", t1 - t0);
 }
 
 Adjoint* create_adjoint(ParameterList const& p, Primal* pr) {
@@ -67,40 +188,188 @@ Adjoint* create_adjoint(ParameterList const& p, Primal* pr) {
 void Adjoint::print_banner(const double t_now) {
   auto ndofs = sol_info->owned->R->getGlobalLength();
   print("**** adjoint solve: %d dofs", ndofs);
+  print("**** for: %d functionals", num_qois);
   print("**** at time: %f", t_now);
 }
 
-void Adjoint::compute_adjoint(const double t_now, const double t_old) {
+void Adjoint::build_base_adjoint() {
+  auto base_poisson = primal->get_poisson();
+  auto fps = get_functional_params(params.sublist("functional"));
+  auto lp = params.sublist("adjoint linear algebra");
+  lp.remove("preconditioner", false);
+  base_linear_solver = create_linear_solver(lp);
+  make_soln(base_poisson, base_adjoint);
+  base_poisson->build_resid<FADT>(base_adjoint);
+  for (int i = 0; i < num_qois; ++i)
+    base_poisson->build_functional<FADT>(fps[i], base_adjoint, i);
+}
+
+void Adjoint::compute_adjoint(
+    SolInfo* s,
+    Evaluators& E,
+    apf::Field* u,
+    const double t_now,
+    const double t_old) {
   auto t0 = time();
   auto dbc = params.sublist("dirichlet bcs");
-  sol_info->resume_fill();
-  sol_info->zero_all();
-  set_time(adjoint, t_now, t_old);
-  assemble(adjoint, sol_info);
-  sol_info->gather_all();
-  set_jac_dbcs(dbc, sol_info, t_now);
-  sol_info->complete_fill();
+  s->resume_fill();
+  s->zero_all();
+  set_time(E, t_now, t_old);
+  assemble(E, s);
+  s->gather_all();
+  set_jac_dbcs(dbc, s, u, t_now, ADJOINT);
+  s->complete_fill();
   auto t1 = time();
   print(" > adjoint computed in %f seconds", t1 - t0);
 }
 
-void Adjoint::solve(const double t_now, const double t_old) {
+void Adjoint::compute_initial_guess(
+    RCP<MultiVectorT> z,
+    const double t_now,
+    const double t_old) {
+  print(" > computing base adjoint initial guess");
+  bool has_data = base_disc->has_data();
+  if (! has_data) base_disc->build_data();
+  auto base_info = create_sol_info(base_disc, num_qois);
+  auto zc = solve_base(base_info, t_now, t_old);
+  P->apply(*zc, *z);
+  destroy_sol_info(base_info);
+  if (! has_data) base_disc->destroy_data();
+}
+
+RCP<MultiVectorT> Adjoint::solve_base(
+    SolInfo* s,
+    const double t_now,
+    const double t_old) {
+  auto map = base_disc->get_owned_map();
+  auto z = rcp(new MultiVectorT(map, num_qois));
+  auto u = primal->get_poisson()->get_soln();
+  compute_adjoint(s, base_adjoint, u, t_now, t_old);
+  auto dRduT = s->owned->dRdu;
+  auto dMdu = s->owned->dMdu;
+  base_linear_solver->solve(dRduT, z, dMdu, base_disc);
+  base_linear_solver->reset();
+  return z;
+}
+
+double Adjoint::estimate_error(
+    SolInfo* s,
+    apf::Field* z_fine,
+    apf::Field* z,
+    apf::Field* e,
+    const double t_now,
+    const double t_old) {
+  Evaluators E;
+  auto u = base_disc->get_apf_mesh()->findField("u");
+  E.push_back(rcp(new Soln<ST>(u, PRIMAL)));
+  E.push_back(rcp(new SolnAdjoint(z_fine, z)));
+  primal->get_poisson()->build_resid<ST>(E);
+  if (e) E.push_back(rcp(new Indicator(E[0], e)));
+  set_time(E, t_now, t_old);
+  s->zero_R();
+  assemble(E, s, 2);
+  s->gather_R();
+  auto R = s->owned->R;
+  VectorT ones(R->getMap());
+  ones.putScalar(1.0);
+  return - (R->dot(ones));
+}
+
+void Adjoint::localize(
+    std::vector<apf::Field*> const& zu,
+    apf::Field* e,
+    const double t_now,
+    const double t_old) {
+  auto t0 = time();
+  bool has_data = base_disc->has_data();
+  if (! has_data) base_disc->build_data();
+  auto base_info = create_sol_info(base_disc, num_qois);
+  for (int i = 0; i < num_qois; ++i) {
+    nested_disc->transfer_adjoint(zu[i]);
+    auto z_fine = nested_disc->get_adjoint_fine();
+    auto z = nested_disc->get_adjoint();
+    estimate_error(base_info, z_fine, z, e, t_now, t_old);
+  }
+  destroy_sol_info(base_info);
+  if (! has_data) base_disc->destroy_data();
+  auto t1 = time();
+  print(" > error localized in %f seconds", t1 - t0);
+}
+
+void Adjoint::solve_patch(
+    const double t_now,
+    const double t_old,
+    apf::Field* e) {
+  bool has_data = base_disc->has_data();
+  if (! has_data) base_disc->build_data();
+  auto base_info = create_sol_info(base_disc, num_qois);
+  auto ndofs = base_info->owned->R->getGlobalLength();
+  print("**** patch adjoint solve: %d dofs", ndofs);
+  print("**** for: %d functionals", num_qois);
+  print("**** at time: %f", t_now);
+  auto z = solve_base(base_info, t_now, t_old);
+  auto m = base_disc->get_apf_mesh();
+  auto dbc = params.sublist("dirichlet bcs");
+  auto P2 = apf::getSerendipity();
+  for (int i = 0; i < num_qois; ++i) {
+    auto name = "zu_" + std::to_string(i);
+    auto fine_name = "zu_fine_" + std::to_string(i);
+    auto zu = apf::createFieldOn(m, name.c_str(), apf::SCALAR);
+    auto zu_fine = apf::createField(m, fine_name.c_str(), apf::SCALAR, P2);
+    base_disc->set_field(z->getVector(i), zu);
+    recover_adjoint(base_disc, dbc, zu, zu_fine);
+    errors[i] = estimate_error(base_info, zu_fine, zu, e, t_now, t_old);
+    print("J_%d(u)-J_%d(u^h) ~ %.15e", i, i, errors[i]);
+    apf::destroyField(zu_fine);
+    apf::destroyField(zu);
+  }
+  destroy_sol_info(base_info);
+  if (! has_data) base_disc->destroy_data();
+}
+
+double Adjoint::get_error() const {
+  double err = 0.0;
+  for (int i = 0; i < num_qois; ++i)
+    err = std::max(err, std::abs(errors[i]));
+  return err;
+}
+
+void Adjoint::solve(const double t_now, const double t_old, apf::Field* e) {
+  errors.assign(num_qois, 0.0);
+  if (e) apf::zeroField(e);
+  if (patch) return solve_patch(t_now, t_old, e);
+  if (! nested_disc) prepare();
+  wait_nested();
+  nested_disc->transfer_soln();
   print_banner(t_now);
   auto R = sol_info->owned->R;
   auto dRduT = sol_info->owned->dRdu;
   auto dMdu = sol_info->owned->dMdu;
-  auto z = rcp(new VectorT(nested_disc->get_owned_map()));
-  auto lp = params.sublist("adjoint linear algebra");
+  auto map = nested_disc->get_owned_map();
+  auto z = rcp(new MultiVectorT(map, num_qois));
   auto nested_mesh = nested_disc->get_apf_mesh();
-  auto zu = apf::createFieldOn(nested_mesh, "zu", apf::SCALAR);
-  compute_adjoint(t_now, t_old);
+  auto nested_shape = nested_disc->get_shape();
+  std::vector<apf::Field*> zu(num_qois);
+  for (int i = 0; i < num_qois; ++i) {
+    auto name = "zu_" + std::to_string(i);
+    zu[i] = apf::createField(
+        nested_mesh, name.c_str(), apf::SCALAR, nested_shape);
+    apf::freeze(zu[i]);
+  }
   z->putScalar(0.0);
-  goal::solve(lp, dRduT, z, dMdu, nested_disc);
-  nested_disc->set_adjoint(z);
-  auto err = - (R->dot(*z));
-  print("J(u)-J(u^h) ~ %.15e", err);
+  if (guess == PROLONGATED) compute_initial_guess(z, t_now, t_old);
+  compute_adjoint(sol_info, adjoint, poisson->get_soln(), t_now, t_old);
+  linear_solver->solve(dRduT, z, dMdu, nested_disc);
+  for (int i = 0; i < num_qois; ++i) {
+    auto zi = z->getVector(i);
+    nested_disc->set_field(zi, zu[i]);
+    errors[i] = - (R->dot(*zi));
+    print("J_%d(u)-J_%d(u^h) ~ %.15e", i, i, errors[i]);
+  }
+  if (e) localize(zu, e, t_now, t_old);
   apf::writeVtkFiles("debug", nested_disc->get_apf_mesh());
-  apf::destroyField(zu);
+  for (int i = 0; i < num_qois; ++i)
+    apf::destroyField(zu[i]);
 }
 
 void destroy_adjoint(Adjoint* a) {
@@ -1,12 +1,20 @@
 #ifndef goal_adjoint_hpp
 #define goal_adjoint_hpp
 
+#include <thread>
 #include <Teuchos_ParameterList.hpp>
 
+#include "goal_data_types.hpp"
+
+namespace apf {
+class Field;
+}
+
 namespace goal {
 
 class Disc;
 class Integrator;
+class LinearSolver;
 class Poisson;
 class Nested;
 class Primal;
@@ -20,17 +28,73 @@ class Adjoint {
   public:
     Adjoint(ParameterList const& p, Primal* pr);
     ~Adjoint();
-    void solve(const double t_now, const double t_old);
+    int get_num_qois() const { return num_qois; }
+    double get_error() const;
+    int get_num_builds() const { return num_builds; }
+    void prepare();
+    void wait_nested();
+    void release_base();
+    void solve(
+        const double t_now,
+        const double t_old,
+        apf::Field* e = 0);
   private:
     void print_banner(const double t_now);
-    void compute_adjoint(const double t_now, const double t_old);
+    void compute_adjoint(
+        SolInfo* s,
+        Evaluators& E,
+        apf::Field* u,
+        const double t_now,
+        const double t_old);
+    void build_prolongation();
+    void build_nested();
+    void start_nested();
+    void finish_nested();
+    void destroy_nested_data();
+    void build_base_adjoint();
+    RCP<MultiVectorT> solve_base(
+        SolInfo* s,
+        const double t_now,
+        const double t_old);
+    double estimate_error(
+        SolInfo* s,
+        apf::Field* z_fine,
+        apf::Field* z,
+        apf::Field* e,
+        const double t_now,
+        const double t_old);
+    void localize(
+        std::vector<apf::Field*> const& zu,
+        apf::Field* e,
+        const double t_now,
+        const double t_old);
+    void solve_patch(
+        const double t_now,
+        const double t_old,
+        apf::Field* e);
+    void compute_initial_guess(
+        RCP<MultiVectorT> z,
+        const double t_now,
+        const double t_old);
     ParameterList params;
     Primal* primal;
     Disc* base_disc;
     Nested* nested_disc;
     Poisson* poisson;
     SolInfo* sol_info;
+    LinearSolver* linear_solver;
+    LinearSolver* base_linear_solver;
     Evaluators adjoint;
+    Evaluators base_adjoint;
+    RCP<MatrixT> P;
+    std::thread builder;
+    std::vector<double> errors;
+    int num_qois;
+    int num_builds;
+    int mode;
+    bool patch;
+    int guess;
+    bool overlap;
 };
 
 Adjoint* create_adjoint(ParameterList const& p, Primal* pr);
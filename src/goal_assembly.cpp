@@ -62,10 +62,11 @@ void post_process(SolInfo* s, Evaluators const& E) {
     E[i]->post_process(s);
 }
 
-void assemble(Evaluators const& E, SolInfo* s) {
+void assemble(Evaluators const& E, SolInfo* s, const int q_order) {
   apf::Vector3 xi;
   auto disc = s->get_disc();
   auto mesh = disc->get_apf_mesh();
+  int q = (q_order > 0) ? q_order : disc->get_q_order();
   pre_process(s, E);
   for (int es = 0; es < disc->get_num_elem_sets(); ++es) {
     set_elem_sets(es, E);
@@ -75,10 +76,12 @@ void assemble(Evaluators const& E, SolInfo* s) {
       auto me = apf::createMeshElement(mesh, elems[elem]);
       gather(me, E);
       in_elem(me, E);
-      apf::getIntPoint(me, 1, 0, xi);
-      double dv = apf::getDV(me, xi);
-      double w = apf::getIntWeight(me, 1, 0);
-      at_point(xi, w, dv, E);
+      for (int p = 0; p < apf::countIntPoints(me, q); ++p) {
+        apf::getIntPoint(me, q, p, xi);
+        double dv = apf::getDV(me, xi);
+        double w = apf::getIntWeight(me, q, p);
+        at_point(xi, w, dv, E);
+      }
       out_elem(E);
       scatter(s, E);
       apf::destroyMeshElement(me);
@@ -13,7 +13,7 @@ using Evaluators = std::vector<RCP<Integrator>>;
 
 RCP<Integrator> find_evaluator(std::string const& n, Evaluators const& E);
 void set_time(Evaluators& E, const double t_now, const double t_old);
-void assemble(Evaluators const& E, SolInfo* s);
+void assemble(Evaluators const& E, SolInfo* s, const int q_order = 0);
 
 }
 
@@ -0,0 +1,54 @@
+#include <apf.h>
+#include <apfMesh2.h>
+#include <parma.h>
+#include <PCU.h>
+
+#include "goal_balance.hpp"
+#include "goal_control.hpp"
+
+namespace goal {
+
+double get_imbalance(apf::Mesh* m, apf::MeshTag* weights) {
+  double w = 0.0;
+  apf::MeshEntity* elem;
+  apf::MeshIterator* elems = m->begin(m->getDimension());
+  while ((elem = m->iterate(elems))) {
+    double ew = 1.0;
+    if (weights) m->getDoubleTag(elem, weights, &ew);
+    w += ew;
+  }
+  m->end(elems);
+  double max_w = PCU_Max_Double(w);
+  double avg_w = PCU_Add_Double(w) / PCU_Comm_Peers();
+  return max_w / avg_w;
+}
+
+static apf::MeshTag* make_unit_weights(apf::Mesh2* m) {
+  double one = 1.0;
+  auto weights = m->createDoubleTag("goal_unit_weight", 1);
+  apf::MeshEntity* elem;
+  apf::MeshIterator* elems = m->begin(m->getDimension());
+  while ((elem = m->iterate(elems)))
+    m->setDoubleTag(elem, weights, &one);
+  m->end(elems);
+  return weights;
+}
+
+void balance(apf::Mesh2* m, apf::MeshTag* weights) {
+  if (PCU_Comm_Peers() == 1) return;
+  auto t0 = time();
+  bool unit = (weights == 0);
+  if (unit) weights = make_unit_weights(m);
+  double before = get_imbalance(m, weights);
+  auto balancer = Parma_MakeElmBalancer(m);
+  balancer->balance(weights, 1.05);
+  delete balancer;
+  double after = get_imbalance(m, weights);
+  if (unit) apf::removeTagFromDimension(m, weights, m->getDimension());
+  if (unit) m->destroyTag(weights);
+  auto t1 = time();
+  print(" > imbalance: %f -> %f", before, after);
+  print(" > mesh balanced in %f seconds", t1 - t0);
+}
+
+}
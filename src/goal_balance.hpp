@@ -0,0 +1,17 @@
+#ifndef goal_balance_hpp
+#define goal_balance_hpp
+
+namespace apf {
+class Mesh;
+class Mesh2;
+class MeshTag;
+}
+
+namespace goal {
+
+double get_imbalance(apf::Mesh* m, apf::MeshTag* weights);
+void balance(apf::Mesh2* m, apf::MeshTag* weights = 0);
+
+}
+
+#endif
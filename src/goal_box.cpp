@@ -0,0 +1,202 @@
+#include <apf.h>
+#include <apfMDS.h>
+#include <apfMesh2.h>
+#include <apfPartition.h>
+#include <cmath>
+#include <ma.h>
+#include <parma.h>
+#include <PCU.h>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "goal_box.hpp"
+#include "goal_control.hpp"
+
+namespace goal {
+
+static ParameterList get_valid_params() {
+  ParameterList p;
+  p.set<Teuchos::Array<int>>("elements", Teuchos::Array<int>());
+  p.set<Teuchos::Array<double>>("lengths", Teuchos::Array<double>());
+  p.set<bool>("simplex", true);
+  p.set<double>("perturbation", 0.0);
+  p.set<int>("serial cells", 1000000);
+  return p;
+}
+
+struct Box {
+  int dim;
+  int n[3];
+  double w[3];
+  bool simplex;
+  double perturbation;
+  long serial_cells;
+};
+
+static Box get_box(ParameterList const& p) {
+  p.validateParameters(get_valid_params(), 0);
+  Box b = {0, {0, 0, 0}, {1.0, 1.0, 1.0}, true, 0.0, 1000000};
+  auto n = p.get<Teuchos::Array<int>>("elements");
+  if (n.size() < 2 || n.size() > 3)
+    fail("box: elements must have 2 or 3 entries");
+  b.dim = n.size();
+  for (int i = 0; i < n.size(); ++i) b.n[i] = n[i];
+  if (p.isParameter("lengths")) {
+    auto w = p.get<Teuchos::Array<double>>("lengths");
+    if (w.size() != n.size())
+      fail("box: lengths must match elements");
+    for (int i = 0; i < w.size(); ++i) b.w[i] = w[i];
+  }
+  if (p.isParameter("simplex"))
+    b.simplex = p.get<bool>("simplex");
+  if (p.isParameter("perturbation"))
+    b.perturbation = p.get<double>("perturbation");
+  if (b.perturbation < 0.0 || b.perturbation >= 0.5)
+    fail("box: perturbation must be in [0, 0.5)");
+  if (p.isParameter("serial cells"))
+    b.serial_cells = p.get<int>("serial cells");
+  if (b.serial_cells < 1)
+    fail("box: serial cells must be positive");
+  return b;
+}
+
+gmi_model* make_box_model(ParameterList const& p) {
+  auto b = get_box(p);
+  return apf::makeMdsBoxModel(b.n[0], b.n[1], b.n[2]);
+}
+
+static long get_num_cells(Box const& b, const int levels) {
+  long cells = 1;
+  for (int i = 0; i < b.dim; ++i)
+    cells *= (b.n[i] >> levels);
+  return cells;
+}
+
+/* rank 0 only builds a coarse box, which is then refined uniformly in
+   parallel. each refinement halves every edge, so the number of levels
+   is limited by how often all element counts divide by two. quad and
+   hex boxes are not refined and are built whole on rank 0. */
+
+static int get_num_levels(Box const& b) {
+  int levels = 0;
+  auto divides = [&] (const int l) {
+    for (int i = 0; i < b.dim; ++i)
+      if (b.n[i] % (1 << l)) return false;
+    return true;
+  };
+  while (b.simplex && get_num_cells(b, levels) > b.serial_cells &&
+         divides(levels + 1))
+    ++levels;
+  if (get_num_cells(b, levels) > b.serial_cells)
+    fail("box: a coarse box of %ld cells exceeds serial cells (%ld); "
+         "use simplex elements with counts divisible by a power of two",
+         get_num_cells(b, levels), b.serial_cells);
+  return levels;
+}
+
+/* vertices sit on the lattice of the fine box before they are moved, so
+   seeding by lattice index gives every copy of a vertex the same offset
+   no matter how the mesh is partitioned. */
+
+static void perturb(apf::Mesh2* m, Box const& b) {
+  if (b.perturbation == 0.0) return;
+  int dim = m->getDimension();
+  std::uniform_real_distribution<double> dist(-0.5, 0.5);
+  apf::Vector3 x;
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = m->begin(0);
+  while ((vtx = m->iterate(vertices))) {
+    if (m->getModelType(m->toModel(vtx)) != dim) continue;
+    m->getPoint(vtx, 0, x);
+    unsigned long seed = 0;
+    for (int i = dim - 1; i >= 0; --i) {
+      long idx = std::lround(x[i] * b.n[i] / b.w[i]);
+      seed = seed * (b.n[i] + 1) + idx;
+    }
+    std::mt19937 gen(seed);
+    for (int i = 0; i < dim; ++i)
+      x[i] += b.perturbation * (b.w[i] / b.n[i]) * dist(gen);
+    m->setPoint(vtx, 0, x);
+  }
+  m->end(vertices);
+}
+
+static apf::Migration* get_split_plan(apf::Mesh2* m, const int factor) {
+  double one = 1.0;
+  int dim = m->getDimension();
+  auto weights = m->createDoubleTag("goal_split_weight", 1);
+  apf::MeshEntity* elem;
+  apf::MeshIterator* elems = m->begin(dim);
+  while ((elem = m->iterate(elems)))
+    m->setDoubleTag(elem, weights, &one);
+  m->end(elems);
+  auto splitter = Parma_MakeRibSplitter(m);
+  auto plan = splitter->split(weights, 1.05, factor);
+  delete splitter;
+  apf::removeTagFromDimension(m, weights, dim);
+  m->destroyTag(weights);
+  return plan;
+}
+
+apf::Mesh2* make_box(ParameterList const& p) {
+  auto t0 = time();
+  auto b = get_box(p);
+  int levels = get_num_levels(b);
+  int self = PCU_Comm_Self();
+  int peers = PCU_Comm_Peers();
+  MPI_Comm comm = PCU_Get_Comm();
+  MPI_Comm group;
+  MPI_Comm_split(comm, self != 0, self, &group);
+  PCU_Switch_Comm(group);
+  apf::Mesh2* m = 0;
+  apf::Migration* plan = 0;
+  gmi_model* g = 0;
+  if (self == 0) {
+    m = apf::makeMdsBox(b.n[0] >> levels, b.n[1] >> levels,
+        b.n[2] >> levels, b.w[0], b.w[1], b.w[2], b.simplex);
+    g = m->getModel();
+    if (peers > 1) plan = get_split_plan(m, peers);
+  }
+  else {
+    g = apf::makeMdsBoxModel(b.n[0], b.n[1], b.n[2]);
+  }
+  PCU_Switch_Comm(comm);
+  MPI_Comm_free(&group);
+  if (peers > 1) m = apf::repeatMdsMesh(m, g, plan, peers);
+  if (levels > 0) ma::adapt(ma::configureUniformRefine(m, levels));
+  perturb(m, b);
+  auto t1 = time();
+  print(" > box mesh built in %f seconds", t1 - t0);
+  return m;
+}
+
+std::string get_box_assoc(const int dim) {
+  static const char axes[3] = {'x', 'y', 'z'};
+  int total = 1;
+  for (int j = 0; j < dim; ++j) total *= 3;
+  int nd[4] = {0, 0, 0, 0};
+  std::vector<int> tags(total);
+  for (int i = 0; i < total; ++i) {
+    int mdim = 0;
+    for (int j = 0, k = i; j < dim; ++j, k /= 3)
+      if (k % 3 == 1) ++mdim;
+    tags[i] = nd[mdim]++;
+  }
+  int center = (total - 1) / 2;
+  std::ostringstream assoc;
+  assoc << "elem set box 1\n" << dim << " " << tags[center] << "\n";
+  for (int j = 0; j < dim; ++j) {
+    int stride = 1;
+    for (int k = 0; k < j; ++k) stride *= 3;
+    for (int side = 0; side < 2; ++side) {
+      auto name = std::string(1, axes[j]) + (side ? "max" : "min");
+      int tag = tags[center + (side ? stride : -stride)];
+      assoc << "node set " << name << " 1\n" << dim - 1 << " " << tag << "\n";
+      assoc << "side set " << name << " 1\n" << dim - 1 << " " << tag << "\n";
+    }
+  }
+  return assoc.str();
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef goal_box_hpp
+#define goal_box_hpp
+
+#include <string>
+#include <Teuchos_ParameterList.hpp>
+
+struct gmi_model;
+
+namespace apf {
+class Mesh2;
+}
+
+namespace goal {
+
+using Teuchos::ParameterList;
+
+gmi_model* make_box_model(ParameterList const& p);
+apf::Mesh2* make_box(ParameterList const& p);
+std::string get_box_assoc(const int dim);
+
+}
+
+#endif
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cctype>
 #include <cstdarg>
 #include <cstdlib>
 #include <Kokkos_Core.hpp>
@@ -23,8 +25,9 @@ static void call_expr_init() {
   evaluator.addVar("double", "val");
 }
 
-static void call_mpi_init() {
-  MPI_Init(0, 0);
+static void call_mpi_init(const int thread_level) {
+  int provided;
+  MPI_Init_thread(0, 0, thread_level, &provided);
   is_mpi_initd = true;
 }
 
@@ -38,9 +41,13 @@ static void call_kokkos_init() {
   is_kokkos_initd = true;
 }
 
-void initialize(bool init_mpi, bool init_kokkos, bool init_pcu) {
+void initialize(
+    bool init_mpi,
+    bool init_kokkos,
+    bool init_pcu,
+    const int thread_level) {
   if (is_goal_initd) return;
-  if (init_mpi) call_mpi_init();
+  if (init_mpi) call_mpi_init(thread_level);
   if (init_kokkos) call_kokkos_init();
   if (init_pcu) call_pcu_init();
   call_expr_init();
@@ -120,6 +127,48 @@ double eval(
   return evaluator.getValueOfVar("val");
 }
 
+static bool is_spatial(std::string const& v) {
+  size_t i = 0;
+  while (i < v.size()) {
+    if (! (std::isalpha(v[i]) || v[i] == '_')) { ++i; continue; }
+    size_t j = i;
+    while (j < v.size() && (std::isalnum(v[j]) || v[j] == '_')) ++j;
+    auto name = v.substr(i, j - i);
+    if (name == "x" || name == "y" || name == "z") return true;
+    i = j;
+  }
+  return false;
+}
+
+void eval(
+    std::string const& v,
+    const int n,
+    const double* x,
+    const double t,
+    double* vals) {
+  assert_initd();
+  std::string value = "val=" + v;
+  evaluator.addBody(value);
+  evaluator.varValueFill(3, t);
+  if (! is_spatial(v)) {
+    evaluator.varValueFill(0, 0.0);
+    evaluator.varValueFill(1, 0.0);
+    evaluator.varValueFill(2, 0.0);
+    evaluator.varValueFill(4, 0.0);
+    evaluator.execute();
+    std::fill(vals, vals + n, evaluator.getValueOfVar("val"));
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    evaluator.varValueFill(0, x[3*i + 0]);
+    evaluator.varValueFill(1, x[3*i + 1]);
+    evaluator.varValueFill(2, x[3*i + 2]);
+    evaluator.varValueFill(4, 0.0);
+    evaluator.execute();
+    vals[i] = evaluator.getValueOfVar("val");
+  }
+}
+
 double time() {
   assert_initd();
   return PCU_Time();
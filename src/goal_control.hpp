@@ -2,13 +2,15 @@
 #define goal_control_hpp
 
 #include <string>
+#include <mpi.h>
 
 namespace goal {
 
 void initialize(
     bool init_mpi = true,
     bool init_kokkos = true,
-    bool init_pcu = true);
+    bool init_pcu = true,
+    const int thread_level = MPI_THREAD_SINGLE);
 
 void finalize();
 
@@ -25,6 +27,13 @@ double eval(
     const double z,
     const double t);
 
+void eval(
+    std::string const& v,
+    const int n,
+    const double* x,
+    const double t,
+    double* vals);
+
 double time();
 
 }
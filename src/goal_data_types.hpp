@@ -22,6 +22,7 @@ using ExportT = Tpetra::Export<LO, GO, KNode>;
 using VectorT = Tpetra::Vector<ST, LO, GO, KNode>;
 using MultiVectorT = Tpetra::MultiVector<ST, LO, GO, KNode>;
 using MatrixT = Tpetra::CrsMatrix<ST, LO, GO, KNode>;
+using OperatorT = Tpetra::Operator<ST, LO, GO, KNode>;
 using MMWriterT = Tpetra::MatrixMarket::Writer<MatrixT>;
 
 }
@@ -9,87 +9,159 @@
 
 namespace goal {
 
+using Teuchos::rcp;
 using Teuchos::Array;
 using Teuchos::getValue;
 
+static bool is_bc(ParameterList const& p, ParameterList::ConstIterator it) {
+  return p.entry(it).isType<Array<std::string>>();
+}
+
+static bool is_symmetric(ParameterList const& p) {
+  if (! p.isType<bool>("symmetric")) return false;
+  return p.get<bool>("symmetric");
+}
+
 static void validate_params(ParameterList const& p, SolInfo* s) {
   auto d = s->get_disc();
   for (auto it = p.begin(); it != p.end(); ++it) {
+    if (! is_bc(p, it)) {
+      GOAL_ALWAYS_ASSERT_VERBOSE(p.name(it) == "symmetric",
+          "dirichlet bcs: expected [set, value] entries");
+      continue;
+    }
     auto entry = p.entry(it);
-    auto a = getValue<Array<std::string>>(entry);
+    auto const& a = getValue<Array<std::string>>(entry);
     GOAL_DEBUG_ASSERT(a.size() == 2);
-    auto set = a[0];
-    auto nodes = d->get_nodes(set);
+    d->get_node_rows(a[0]);
   }
 }
 
-static double get_val(
-    apf::Field* f,
+static void get_vals(
+    Disc* d,
+    std::string const& set,
     std::string const& val,
-    apf::Node const& node,
-    const double t) {
-  apf::Vector3 x;
-  auto e = node.entity;
-  auto m = apf::getMesh(f);
-  m->getPoint(e, 0, x);
-  double v = eval(val, x[0], x[1], x[2], t);
-  return v;
+    const double t,
+    std::vector<double>& vals) {
+  auto const& xyz = d->get_node_coords(set);
+  int num_nodes = xyz.size() / 3;
+  vals.resize(num_nodes);
+  if (num_nodes == 0) return;
+  eval(val, num_nodes, &xyz[0], t, &vals[0]);
 }
 
-void set_resid_dbcs(ParameterList const& p, SolInfo* s, const double t) {
+static void eliminate_cols(
+    SolInfo* s,
+    RCP<VectorT> mask,
+    RCP<VectorT> g,
+    const int mode) {
+  auto R = s->owned->R;
+  auto dRdu = s->owned->dRdu;
+  auto row_map = dRdu->getRowMap();
+  auto col_map = dRdu->getColMap();
+  auto importer = dRdu->getGraph()->getImporter();
+  auto col_mask = mask;
+  auto col_g = g;
+  if (! importer.is_null()) {
+    col_mask = rcp(new VectorT(col_map));
+    col_g = rcp(new VectorT(col_map));
+    col_mask->doImport(*mask, *importer, Tpetra::INSERT);
+    col_g->doImport(*g, *importer, Tpetra::INSERT);
+  }
+  auto is_dbc_row = mask->getData(0);
+  auto is_dbc_col = col_mask->getData(0);
+  auto g_col = col_g->getData(0);
+  auto r = R->getDataNonConst(0);
+  Array<LO> indices;
+  Array<ST> entries;
+  LO num_rows = row_map->getNodeNumElements();
+  for (LO row = 0; row < num_rows; ++row) {
+    if (is_dbc_row[row] > 0.0) continue;
+    size_t num_cols = dRdu->getNumEntriesInLocalRow(row);
+    indices.resize(num_cols);
+    entries.resize(num_cols);
+    dRdu->getLocalRowCopy(row, indices(), entries(), num_cols);
+    bool modified = false;
+    for (size_t i = 0; i < num_cols; ++i) {
+      LO col = indices[i];
+      if (is_dbc_col[col] == 0.0) continue;
+      if (mode == PRIMAL) r[row] += entries[i] * g_col[col];
+      entries[i] = 0.0;
+      modified = true;
+    }
+    if (modified) dRdu->replaceLocalValues(row, indices(), entries());
+  }
+}
+
+void set_resid_dbcs(
+    ParameterList const& p,
+    SolInfo* s,
+    apf::Field* u,
+    const double t) {
   validate_params(p, s);
   auto d = s->get_disc();
   auto R = s->owned->R;
-  auto u = d->get_apf_mesh()->findField("u");
+  std::vector<double> vals;
   for (auto it = p.begin(); it != p.end(); ++it) {
+    if (! is_bc(p, it)) continue;
     auto entry = p.entry(it);
-    auto a = getValue<Array<std::string>>(entry);
-    auto set = a[0];
-    auto val = a[1];
-    auto nodes = d->get_nodes(set);
-    for (size_t node = 0; node < nodes.size(); ++node) {
-      auto n = nodes[node];
-      GO row = d->get_gid(n, 0);
-      auto sol = apf::getScalar(u, n.entity, n.node);
-      double v = get_val(u, val, n, t);
-      R->replaceGlobalValue(row, sol - v);
+    auto const& a = getValue<Array<std::string>>(entry);
+    auto const& nodes = d->get_nodes(a[0]);
+    auto const& rows = d->get_node_rows(a[0]);
+    get_vals(d, a[0], a[1], t, vals);
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      auto sol = apf::getScalar(u, nodes[n].entity, nodes[n].node);
+      R->replaceLocalValue(rows[n], sol - vals[n]);
     }
   }
 }
 
-void set_jac_dbcs(ParameterList const& p, SolInfo* s, const double t) {
+void set_jac_dbcs(
+    ParameterList const& p,
+    SolInfo* s,
+    apf::Field* u,
+    const double t,
+    const int mode) {
   validate_params(p, s);
   auto d = s->get_disc();
   auto R = s->owned->R;
   auto dRdu = s->owned->dRdu;
   auto dMdu = s->owned->dMdu;
-  Array<ST> entries, entry(1);
-  Array<GO> indices, index(1);
-  entry[0] = 1.0;
-  auto u = d->get_apf_mesh()->findField("u");
+  auto row_map = d->get_owned_map();
+  auto num_qois = dMdu->getNumVectors();
+  auto sym = is_symmetric(p);
+  RCP<VectorT> mask, g;
+  if (sym) {
+    mask = rcp(new VectorT(row_map));
+    g = rcp(new VectorT(row_map));
+  }
+  auto local = dRdu->getLocalMatrix();
+  auto row_ptr = local.graph.row_map;
+  auto entries = local.values;
+  std::vector<double> vals;
   for (auto it = p.begin(); it != p.end(); ++it) {
+    if (! is_bc(p, it)) continue;
     auto pentry = p.entry(it);
-    auto a = getValue<Array<std::string>>(pentry);
-    auto set = a[0];
-    auto val = a[1];
-    auto nodes = d->get_nodes(set);
-    for (size_t node = 0; node < nodes.size(); ++node) {
-      auto n = nodes[node];
-      GO row = d->get_gid(n, 0);
-      index[0] = row;
-      auto sol = apf::getScalar(u, n.entity, n.node);
-      double v = get_val(u, val, n, t);
-      R->replaceGlobalValue(row, sol - v);
-      dMdu->replaceGlobalValue(row, 0.0);
-      size_t num_cols = dRdu->getNumEntriesInGlobalRow(row);
-      indices.resize(num_cols);
-      entries.resize(num_cols);
-      dRdu->getGlobalRowCopy(row, indices(), entries(), num_cols);
-      for (size_t col = 0; col < num_cols; ++col) entries[col] = 0.0;
-      dRdu->replaceGlobalValues(row, indices(), entries());
-      dRdu->replaceGlobalValues(row, index(), entry());
+    auto const& a = getValue<Array<std::string>>(pentry);
+    auto const& nodes = d->get_nodes(a[0]);
+    auto const& rows = d->get_node_rows(a[0]);
+    auto const& diags = d->get_node_diags(a[0]);
+    get_vals(d, a[0], a[1], t, vals);
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      LO row = rows[n];
+      auto sol = apf::getScalar(u, nodes[n].entity, nodes[n].node);
+      R->replaceLocalValue(row, sol - vals[n]);
+      for (size_t q = 0; q < num_qois; ++q)
+        dMdu->replaceLocalValue(row, q, 0.0);
+      for (auto k = row_ptr(row); k < row_ptr(row + 1); ++k)
+        entries(k) = 0.0;
+      entries(row_ptr(row) + diags[n]) = 1.0;
+      if (! sym) continue;
+      mask->replaceLocalValue(row, 1.0);
+      g->replaceLocalValue(row, vals[n] - sol);
     }
   }
+  if (sym) eliminate_cols(s, mask, g, mode);
 }
 
 }
@@ -1,18 +1,33 @@
 #ifndef goal_dbcs_hpp
 #define goal_dbcs_hpp
 
+#include "goal_eval_modes.hpp"
+
 namespace Teuchos {
 class ParameterList;
 }
 
+namespace apf {
+class Field;
+}
+
 namespace goal {
 
 using Teuchos::ParameterList;
 
 class SolInfo;
 
-void set_resid_dbcs(ParameterList const& p, SolInfo* s, const double t);
-void set_jac_dbcs(ParameterList const& p, SolInfo* s, const double t);
+void set_resid_dbcs(
+    ParameterList const& p,
+    SolInfo* s,
+    apf::Field* u,
+    const double t);
+void set_jac_dbcs(
+    ParameterList const& p,
+    SolInfo* s,
+    apf::Field* u,
+    const double t,
+    const int mode = PRIMAL);
 
 }
 
@@ -5,6 +5,11 @@
 #include <apfNumbering.h>
 #include <apfShape.h>
 #include <gmi_mesh.h>
+#include <sys/stat.h>
+#include <PCU.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 #include <Teuchos_ParameterList.hpp>
 
 #ifdef GOAL_ENABLE_SNAPPING
@@ -12,8 +17,10 @@
 #include <SimUtil.h>
 #endif
 
+#include "goal_box.hpp"
 #include "goal_control.hpp"
 #include "goal_disc.hpp"
+#include "goal_snapshot.hpp"
 
 namespace goal {
 
@@ -22,20 +29,61 @@ static ParameterList get_valid_params() {
   p.set<std::string>("geom file", "");
   p.set<std::string>("mesh file", "");
   p.set<std::string>("assoc file", "");
+  p.set<std::string>("snapshot", "");
+  p.set<std::string>("verify", "");
+  p.sublist("box");
   return p;
 }
 
-static apf::StkModels* read_sets(apf::Mesh* m, ParameterList const& p) {
+static int get_verify(ParameterList const& p) {
+  if (! p.isParameter("verify")) return VERIFY_FULL;
+  int level = VERIFY_FULL;
+  auto v = p.get<std::string>("verify");
+  if (v == "full") level = VERIFY_FULL;
+  else if (v == "sampled") level = VERIFY_SAMPLED;
+  else if (v == "off") level = VERIFY_OFF;
+  else fail("unknown verify level: %s", v.c_str());
+  return level;
+}
+
+static void stamp_file(
+    std::ostream& key,
+    std::string const& name,
+    std::string const& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st)) return;
+  key << name << ": " << st.st_size << " " << st.st_mtime << "\n";
+}
+
+static std::string get_mesh_part(std::string const& mesh_file) {
+  auto ext = mesh_file.rfind(".smb");
+  if (ext == std::string::npos) return mesh_file;
+  auto rank = std::to_string(PCU_Comm_Self());
+  return mesh_file.substr(0, ext) + rank + ".smb";
+}
+
+static std::string get_snapshot_key(ParameterList const& p) {
+  ParameterList inputs(p);
+  inputs.remove("snapshot", false);
+  inputs.remove("verify", false);
+  std::ostringstream key;
+  inputs.print(key, 0, false, false);
+  key << "parts: " << PCU_Comm_Peers() << "\n";
+  if (p.isParameter("geom file"))
+    stamp_file(key, "geom", p.get<std::string>("geom file"));
+  if (p.isParameter("mesh file"))
+    stamp_file(key, "mesh", get_mesh_part(p.get<std::string>("mesh file")));
+  if (p.isParameter("assoc file"))
+    stamp_file(key, "assoc", p.get<std::string>("assoc file"));
+  return key.str();
+}
+
+static apf::StkModels* read_sets(apf::Mesh* m, std::istream& f) {
   auto sets = new apf::StkModels;
-  auto fn = p.get<std::string>("assoc file");
-  auto filename = fn.c_str();
-  print("reading association file: %s", filename);
   static std::string const setNames[3] = {
     "node set", "side set", "elem set"};
   auto d = m->getDimension();
   int dims[3] = {0, d - 1, d};
-  std::ifstream f(filename);
-  if (!f.good()) fail("cannot open file: %s", filename);
   std::string sline;
   int lc = 0;
   while (std::getline(f, sline)) {
@@ -73,6 +121,20 @@ static apf::StkModels* read_sets(apf::Mesh* m, ParameterList const& p) {
   return sets;
 }
 
+static apf::StkModels* read_sets(apf::Mesh* m, ParameterList const& p) {
+  auto fn = p.get<std::string>("assoc file");
+  auto filename = fn.c_str();
+  print("reading association file: %s", filename);
+  std::ifstream f(filename);
+  if (!f.good()) fail("cannot open file: %s", filename);
+  return read_sets(m, f);
+}
+
+static apf::StkModels* read_box_sets(apf::Mesh* m) {
+  std::istringstream f(get_box_assoc(m->getDimension()));
+  return read_sets(m, f);
+}
+
 static void initialize_sim() {
 #ifdef GOAL_ENABLE_SNAPPING
   Sim_readLicenseFile(0);
@@ -88,33 +150,75 @@ static void finalize_sim() {
 #endif
 }
 
-static void load_mesh(apf::Mesh2** mesh, ParameterList const& p) {
+static void load_mesh(
+    apf::Mesh2** mesh,
+    ParameterList const& p,
+    std::string const& mesh_file) {
   gmi_register_mesh();
   initialize_sim();
   auto geom_file = p.get<std::string>("geom file");
-  auto mesh_file = p.get<std::string>("mesh file");
   auto g = geom_file.c_str();
   auto m = mesh_file.c_str();
   *mesh = apf::loadMdsMesh(g, m);
 }
 
+static apf::Mesh2* load_box_mesh(
+    ParameterList const& p,
+    std::string const& mesh_file) {
+  return apf::loadMdsMesh(make_box_model(p), mesh_file.c_str());
+}
+
 Disc::Disc() {
+  owns_mesh = true;
+  shape = 0;
+  nmbr_name = "nmbr";
+  verify = VERIFY_FULL;
+  checked_classification = false;
+  snap = 0;
+  save_snap = false;
 }
 
 Disc::Disc(ParameterList const& p) {
   p.validateParameters(get_valid_params(), 0);
   is_base = true;
-  load_mesh(&mesh, p);
-  sets = read_sets(mesh, p);
-  apf::reorderMdsMesh(mesh);
-  mesh->verify();
+  owns_mesh = true;
+  shape = 0;
+  nmbr_name = "nmbr";
+  verify = get_verify(p);
+  checked_classification = false;
+  snap = 0;
+  save_snap = false;
+  if (p.isParameter("snapshot"))
+    snap_prefix = p.get<std::string>("snapshot");
+  if (snap_prefix.size())
+    snap_key = get_snapshot_key(p);
+  bool is_box = p.isSublist("box");
+  if (snap_prefix.size() && has_snapshot(snap_prefix, snap_key)) {
+    print("reading snapshot: %s", snap_prefix.c_str());
+    auto snap_mesh = get_snapshot_mesh(snap_prefix);
+    if (is_box) mesh = load_box_mesh(p.sublist("box"), snap_mesh);
+    else load_mesh(&mesh, p, snap_mesh);
+    snap = new Snapshot(snap_prefix, snap_key);
+    sets = snap->get_sets(mesh);
+  }
+  else {
+    if (is_box) mesh = make_box(p.sublist("box"));
+    else load_mesh(&mesh, p, p.get<std::string>("mesh file"));
+    if (is_box) sets = read_box_sets(mesh);
+    else sets = read_sets(mesh, p);
+    apf::reorderMdsMesh(mesh);
+    if (verify == VERIFY_FULL) mesh->verify();
+    save_snap = (snap_prefix.size() > 0);
+    if (save_snap) mesh->writeNative(get_snapshot_mesh(snap_prefix).c_str());
+  }
   initialize();
 }
 
 Disc::~Disc() {
   destroy_data();
-  mesh->destroyNative();
-  apf::destroyMesh(mesh);
+  release_snapshot();
+  if (owns_mesh) mesh->destroyNative();
+  if (owns_mesh) apf::destroyMesh(mesh);
   if (is_base) delete sets;
   if (is_base) finalize_sim();
 }
@@ -149,9 +253,27 @@ NodeSet const& Disc::get_nodes(std::string const& ns_name) {
   return node_sets[ns_name];
 }
 
+std::vector<LO> const& Disc::get_node_rows(std::string const& ns_name) {
+  GOAL_DEBUG_ASSERT(node_rows.count(ns_name));
+  return node_rows[ns_name];
+}
+
+std::vector<LO> const& Disc::get_node_diags(std::string const& ns_name) {
+  GOAL_DEBUG_ASSERT(node_diags.count(ns_name));
+  return node_diags[ns_name];
+}
+
+std::vector<double> const& Disc::get_node_coords(std::string const& ns_name) {
+  GOAL_DEBUG_ASSERT(node_coords.count(ns_name));
+  return node_coords[ns_name];
+}
+
+int Disc::get_q_order() const {
+  return 2 * shape->getOrder() - 1;
+}
+
 int Disc::get_num_nodes(apf::MeshEntity* e) {
   auto type = mesh->getType(e);
-  auto shape = mesh->getShape();
   auto es = shape->getEntityShape(type);
   return es->countNodes();
 }
@@ -191,13 +313,24 @@ void Disc::get_gids(apf::MeshEntity* e, std::vector<GO>& gids) {
 
 void Disc::build_data() {
   auto t0 = time();
-  compute_owned_maps();
+  if (snap) {
+    load_snapshot();
+  }
+  else {
+    compute_owned_maps();
+    compute_ghost_map();
+    compute_graphs();
+  }
   compute_coords();
-  compute_ghost_map();
-  compute_graphs();
   compute_elem_sets();
   compute_side_sets();
   compute_node_sets();
+  compute_node_rows();
+  if (save_snap) {
+    write_snapshot(snap_prefix, snap_key, mesh, sets, nmbr, node_map,
+        owned_map, ghost_map, owned_graph, ghost_graph);
+    save_snap = false;
+  }
   auto t1 = time();
   print(" > disc: data built in %f seconds", t1 - t0);
 }
@@ -208,8 +341,12 @@ void Disc::destroy_data() {
     elem_sets[get_elem_set_name(i)].resize(0);
   for (int i = 0; i < get_num_side_sets(); ++i)
     side_sets[get_side_set_name(i)].resize(0);
-  for (int i = 0; i < get_num_node_sets(); ++i)
+  for (int i = 0; i < get_num_node_sets(); ++i) {
     node_sets[get_node_set_name(i)].resize(0);
+    node_rows[get_node_set_name(i)].resize(0);
+    node_diags[get_node_set_name(i)].resize(0);
+    node_coords[get_node_set_name(i)].resize(0);
+  }
   node_map = Teuchos::null;
   owned_map = Teuchos::null;
   ghost_map = Teuchos::null;
@@ -219,6 +356,30 @@ void Disc::destroy_data() {
   nmbr = 0;
 }
 
+void Disc::release_snapshot() {
+  delete snap;
+  snap = 0;
+  save_snap = false;
+}
+
+void Disc::mesh_changed() {
+  release_snapshot();
+  checked_classification = false;
+}
+
+void Disc::load_snapshot() {
+  GOAL_DEBUG_ASSERT(! nmbr);
+  nmbr = snap->get_numbering(mesh, nmbr_name.c_str(), shape);
+  node_map = Tpetra::createNonContigMap<LO, GO>(
+      snap->get_owned_nodes(), comm);
+  owned_map = Tpetra::createNonContigMap<LO, GO>(
+      snap->get_owned_dofs(), comm);
+  ghost_map = Tpetra::createNonContigMap<LO, GO>(
+      snap->get_ghost_dofs(), comm);
+  owned_graph = snap->get_graph(OWNED_GRAPH, owned_map, comm);
+  ghost_graph = snap->get_graph(GHOST_GRAPH, ghost_map, comm);
+}
+
 void Disc::add_soln(RCP<VectorT> du) {
   apf::DynamicArray<apf::Node> nodes;
   apf::getNodes(nmbr, nodes);
@@ -238,19 +399,46 @@ void Disc::add_soln(RCP<VectorT> du) {
   apf::synchronize(u);
 }
 
+void Disc::set_field(RCP<const VectorT> x, apf::Field* f) {
+  apf::DynamicArray<apf::Node> nodes;
+  apf::getNodes(nmbr, nodes);
+  auto data = x->get1dView();
+  for (size_t n = 0; n < nodes.size(); ++n) {
+    auto node = nodes[n];
+    auto ent = node.entity;
+    auto lnode = node.node;
+    if (! mesh->isOwned(ent)) continue;
+    GO row = get_gid(node, 0);
+    LO lrow = owned_map->getLocalElement(row);
+    double soln = data[lrow];
+    apf::setScalar(f, ent, lnode, soln);
+  }
+  apf::synchronize(f);
+}
+
 void Disc::initialize() {
   num_dims = mesh->getDimension();
   num_eqs = 1;
   num_elem_sets = sets->models[num_dims].size();
   num_side_sets = sets->models[num_dims-1].size();
   num_node_sets = sets->models[0].size();
-  comm = Tpetra::DefaultPlatform::getDefaultPlatform().getComm();
+  if (comm.is_null())
+    comm = Tpetra::DefaultPlatform::getDefaultPlatform().getComm();
+  if (! shape) shape = mesh->getShape();
   nmbr = 0;
 }
 
+void Disc::get_point(apf::Node const& n, apf::Vector3& x) {
+  if (mesh->getType(n.entity) == apf::Mesh::VERTEX)
+    mesh->getPoint(n.entity, 0, x);
+  else
+    x = apf::getLinearCentroid(mesh, n.entity);
+}
+
 void Disc::compute_owned_maps() {
   GOAL_DEBUG_ASSERT(! nmbr);
-  nmbr = apf::makeGlobal(apf::numberOwnedNodes(mesh, "nmbr"));
+  auto name = nmbr_name.c_str();
+  nmbr = apf::makeGlobal(apf::numberOwnedNodes(mesh, name, shape));
   apf::DynamicArray<apf::Node> owned;
   apf::getNodes(nmbr, owned);
   auto num_owned = owned.getSize();
@@ -270,13 +458,15 @@ void Disc::compute_owned_maps() {
 void Disc::compute_coords() {
   coords = rcp(new MultiVectorT(node_map, num_dims, false));
   apf::Vector3 x(0, 0, 0);
-  apf::DynamicArray<apf::Node> owned;
-  apf::getNodes(nmbr, owned);
-  for (size_t n = 0; n < owned.size(); ++n) {
-    auto node = owned[n];
-    mesh->getPoint(node.entity, node.node, x);
+  apf::DynamicArray<apf::Node> nodes;
+  apf::getNodes(nmbr, nodes);
+  LO n = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (! mesh->isOwned(nodes[i].entity)) continue;
+    get_point(nodes[i], x);
     for (int dim = 0; dim < num_dims; ++dim)
       coords->replaceLocalValue(n, dim, x[dim]);
+    ++n;
   }
 }
 
@@ -326,6 +516,8 @@ void Disc::compute_elem_sets() {
   auto it = mesh->begin(num_dims);
   while ((elem = mesh->iterate(it))) {
     auto mr = mesh->toModel(elem);
+    if (verify != VERIFY_OFF && ! sets->invMaps[num_dims].count(mr))
+      fail("element classified outside of every element set");
     auto stkm = sets->invMaps[num_dims][mr];
     auto name = stkm->stkName;
     elem_sets[name].push_back(elem);
@@ -345,14 +537,58 @@ void Disc::compute_side_sets() {
     auto name = stkm->stkName;
     apf::Up adj_elems;
     mesh->getUp(side, adj_elems);
-    GOAL_DEBUG_ASSERT_VERBOSE(adj_elems.n == 1,
-        "side set defined on non-manifold geometric entity?");
+    if (verify != VERIFY_OFF && adj_elems.n != 1)
+      fail("side set %s defined on non-manifold entity", name.c_str());
     side_sets[name].push_back(side);
   }
   mesh->end(it);
 }
 
+/* node sets are gathered on owners only, from the owner's model
+   classification. this checks that every remote copy of a node-bearing
+   entity agrees on that classification, so membership is the same no
+   matter which part owns the entity. mesh->verify() already covers this
+   at the full level, so it only runs once per mesh at the sampled level. */
+
+static void check_node_classification(apf::Mesh* m, apf::FieldShape* s) {
+  PCU_Comm_Begin();
+  for (int dim = 0; dim < m->getDimension(); ++dim) {
+    if (! s->hasNodesIn(dim)) continue;
+    apf::MeshEntity* ent;
+    apf::MeshIterator* it = m->begin(dim);
+    while ((ent = m->iterate(it))) {
+      if (! m->isShared(ent)) continue;
+      auto me = m->toModel(ent);
+      int type = m->getModelType(me);
+      int tag = m->getModelTag(me);
+      apf::Copies remotes;
+      m->getRemotes(ent, remotes);
+      APF_ITERATE(apf::Copies, remotes, rit) {
+        PCU_COMM_PACK(rit->first, rit->second);
+        PCU_COMM_PACK(rit->first, type);
+        PCU_COMM_PACK(rit->first, tag);
+      }
+    }
+    m->end(it);
+  }
+  PCU_Comm_Send();
+  while (PCU_Comm_Receive()) {
+    apf::MeshEntity* ent;
+    int type, tag;
+    PCU_COMM_UNPACK(ent);
+    PCU_COMM_UNPACK(type);
+    PCU_COMM_UNPACK(tag);
+    auto me = m->toModel(ent);
+    if (m->getModelType(me) != type || m->getModelTag(me) != tag)
+      fail("part copies disagree on node classification");
+  }
+}
+
 void Disc::compute_node_sets() {
+  if (verify == VERIFY_SAMPLED && ! checked_classification) {
+    check_node_classification(mesh, shape);
+    checked_classification = true;
+  }
   for (int i = 0; i < num_node_sets; ++i)
     node_sets[ get_node_set_name(i) ].resize(0);
   apf::DynamicArray<apf::Node> nodes;
@@ -373,6 +609,34 @@ void Disc::compute_node_sets() {
   }
 }
 
+void Disc::compute_node_rows() {
+  apf::Vector3 x(0, 0, 0);
+  auto col_map = owned_graph->getColMap();
+  Teuchos::ArrayView<const LO> cols;
+  for (int i = 0; i < num_node_sets; ++i) {
+    auto name = get_node_set_name(i);
+    auto const& nodes = node_sets[name];
+    auto& rows = node_rows[name];
+    auto& diags = node_diags[name];
+    auto& xyz = node_coords[name];
+    rows.resize(nodes.size());
+    diags.resize(nodes.size());
+    xyz.resize(3 * nodes.size());
+    for (size_t n = 0; n < nodes.size(); ++n) {
+      GO row = get_gid(nodes[n], 0);
+      rows[n] = owned_map->getLocalElement(row);
+      GOAL_DEBUG_ASSERT(rows[n] >= 0);
+      LO diag = col_map->getLocalElement(row);
+      owned_graph->getLocalRowView(rows[n], cols);
+      diags[n] = std::find(cols.begin(), cols.end(), diag) - cols.begin();
+      GOAL_DEBUG_ASSERT(diags[n] < LO(cols.size()));
+      get_point(nodes[n], x);
+      for (int dim = 0; dim < 3; ++dim)
+        xyz[3*n + dim] = x[dim];
+    }
+  }
+}
+
 Disc* create_disc(ParameterList const& p) {
   return new Disc(p);
 }
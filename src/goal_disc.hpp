@@ -4,6 +4,9 @@
 #include "goal_data_types.hpp"
 
 namespace apf {
+class Field;
+class FieldShape;
+class Vector3;
 struct Node;
 struct StkModels;
 class Mesh2;
@@ -14,6 +17,10 @@ typedef NumberingOf<long> GlobalNumbering;
 
 namespace goal {
 
+class Snapshot;
+
+enum VerifyLevel { VERIFY_FULL, VERIFY_SAMPLED, VERIFY_OFF };
+
 using Teuchos::RCP;
 using Teuchos::ParameterList;
 using ElemSet = std::vector<apf::MeshEntity*>;
@@ -22,6 +29,8 @@ using NodeSet = std::vector<apf::Node>;
 using ElemSets = std::map<std::string, ElemSet>;
 using SideSets = std::map<std::string, SideSet>;
 using NodeSets = std::map<std::string, NodeSet>;
+using NodeRows = std::map<std::string, std::vector<LO>>;
+using NodeCoords = std::map<std::string, std::vector<double>>;
 
 class Disc {
   public:
@@ -29,8 +38,12 @@ class Disc {
     Disc(ParameterList const& p);
     ~Disc();
     apf::Mesh2* get_apf_mesh() { return mesh; }
+    apf::FieldShape* get_shape() { return shape; }
+    int get_q_order() const;
+    int get_verify() const { return verify; }
     apf::StkModels* get_model_sets() { return sets; }
     bool is_parent() const { return is_base; }
+    bool has_data() const { return Teuchos::nonnull(owned_map); }
     int get_num_eqs() const { return num_eqs; }
     int get_num_dims() const { return num_dims; }
     int get_num_elem_sets() const { return num_elem_sets; }
@@ -47,16 +60,24 @@ class Disc {
     ElemSet const& get_elems(std::string const& es_name);
     SideSet const& get_sides(std::string const& ss_name);
     NodeSet const& get_nodes(std::string const& ns_name);
+    std::vector<LO> const& get_node_rows(std::string const& ns_name);
+    std::vector<LO> const& get_node_diags(std::string const& ns_name);
+    std::vector<double> const& get_node_coords(std::string const& ns_name);
     int get_num_nodes(apf::MeshEntity* e);
     int get_num_dofs(apf::MeshEntity* e);
     GO get_gid(apf::MeshEntity* e, const int n, const int eq);
     GO get_gid(apf::Node const& n, const int eq);
     void get_gids(apf::MeshEntity* e, std::vector<GO>& gids);
     void add_soln(RCP<VectorT> du);
+    void set_field(RCP<const VectorT> x, apf::Field* f);
     void build_data();
     void destroy_data();
+    void release_snapshot();
+    void mesh_changed();
+    bool is_restart() const { return snap != 0; }
   protected:
     void initialize();
+    void get_point(apf::Node const& n, apf::Vector3& x);
     void compute_owned_maps();
     void compute_coords();
     void compute_ghost_map();
@@ -64,18 +85,32 @@ class Disc {
     void compute_elem_sets();
     void compute_side_sets();
     void compute_node_sets();
+    void compute_node_rows();
+    void load_snapshot();
     bool is_base;
+    bool owns_mesh;
+    int verify;
+    bool checked_classification;
     int num_dims;
     int num_eqs;
     int num_elem_sets;
     int num_side_sets;
     int num_node_sets;
     apf::Mesh2* mesh;
+    apf::FieldShape* shape;
+    std::string nmbr_name;
     apf::StkModels* sets;
     apf::GlobalNumbering* nmbr;
+    Snapshot* snap;
+    std::string snap_prefix;
+    std::string snap_key;
+    bool save_snap;
     ElemSets elem_sets;
     SideSets side_sets;
     NodeSets node_sets;
+    NodeRows node_rows;
+    NodeRows node_diags;
+    NodeCoords node_coords;
     RCP<const Comm> comm;
     RCP<const MapT> node_map;
     RCP<const MapT> owned_map;
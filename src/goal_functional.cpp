@@ -21,30 +21,51 @@ static void make_soln(Poisson* m, Evaluators& e) {
   e.push_back(w);
 }
 
+std::vector<ParameterList> get_functional_params(ParameterList const& p) {
+  std::vector<ParameterList> fps;
+  if (p.isParameter("type")) {
+    fps.push_back(p);
+    return fps;
+  }
+  for (auto it = p.begin(); it != p.end(); ++it) {
+    auto name = p.name(it);
+    if (! p.isSublist(name))
+      fail("functional: expected a sublist for: %s", name.c_str());
+    fps.push_back(p.sublist(name));
+  }
+  if (fps.empty()) fail("functional: no functionals specified");
+  return fps;
+}
+
 Functional::Functional(ParameterList const& p, Primal* pr) {
   params = p;
   primal = pr;
   poisson = primal->get_poisson();
   sol_info = 0;
-  auto fp = params.sublist("functional");
+  auto fps = get_functional_params(params.sublist("functional"));
   make_soln(poisson, evaluators);
-  poisson->build_functional<ST>(fp, evaluators);
-  auto eval = evaluators.back();
-  functional = rcp_static_cast<QoI<ST>>(eval);
+  for (size_t i = 0; i < fps.size(); ++i) {
+    poisson->build_functional<ST>(fps[i], evaluators, i);
+    auto eval = evaluators.back();
+    functionals.push_back(rcp_static_cast<QoI<ST>>(eval));
+  }
 }
 
 Functional::~Functional() {
 }
 
-double Functional::get_value() {
-  return functional->get_qoi_value();
+double Functional::get_value(const int i) {
+  GOAL_DEBUG_ASSERT(i < get_num_functionals());
+  return functionals[i]->get_qoi_value();
 }
 
 void Functional::print_value() {
-  auto n = functional->get_name();
-  auto J = functional->get_qoi_value();
-  print(" > functional : %s", n.c_str());
-  print(" > J(uH) = %.15e", J);
+  for (size_t i = 0; i < functionals.size(); ++i) {
+    auto n = functionals[i]->get_name();
+    auto J = functionals[i]->get_qoi_value();
+    print(" > functional %zu : %s", i, n.c_str());
+    print(" > J(uH) = %.15e", J);
+  }
 }
 
 void Functional::compute(const double t_now, const double t_old) {
@@ -16,11 +16,14 @@ using Teuchos::RCP;
 using Teuchos::ParameterList;
 using Evaluators = std::vector<RCP<Integrator>>;
 
+std::vector<ParameterList> get_functional_params(ParameterList const& p);
+
 class Functional {
   public:
     Functional(ParameterList const& p, Primal* pr);
     ~Functional();
-    double get_value();
+    int get_num_functionals() const { return functionals.size(); }
+    double get_value(const int i = 0);
     void print_value();
     void compute(const double t_now, const double t_old);
   private:
@@ -28,7 +31,7 @@ class Functional {
     Primal* primal;
     Poisson* poisson;
     SolInfo* sol_info;
-    RCP<QoI<ST>> functional;
+    std::vector<RCP<QoI<ST>>> functionals;
     Evaluators evaluators;
 };
 
@@ -0,0 +1,34 @@
+#include <cmath>
+#include <apf.h>
+
+#include "goal_control.hpp"
+#include "goal_indicator.hpp"
+#include "goal_soln.hpp"
+
+namespace goal {
+
+using Teuchos::rcp_static_cast;
+
+Indicator::Indicator(RCP<Integrator> u_, apf::Field* e) :
+    u(rcp_static_cast<Soln<ST>>(u_)),
+    error(e),
+    elem(0) {
+  GOAL_DEBUG_ASSERT(Teuchos::nonnull(u));
+  GOAL_DEBUG_ASSERT(apf::getValueType(error) == apf::SCALAR);
+  this->name = "indicator";
+}
+
+void Indicator::in_elem(apf::MeshElement* me) {
+  elem = apf::getMeshEntity(me);
+}
+
+void Indicator::out_elem() {
+  double eta = 0.0;
+  for (int n = 0; n < u->get_num_nodes(); ++n)
+    eta -= u->resid(n);
+  eta = std::abs(eta) + apf::getScalar(error, elem, 0);
+  apf::setScalar(error, elem, 0, eta);
+  elem = 0;
+}
+
+}
@@ -0,0 +1,32 @@
+#ifndef goal_indicator_hpp
+#define goal_indicator_hpp
+
+#include <Teuchos_RCP.hpp>
+
+#include "goal_integrator.hpp"
+#include "goal_scalar_types.hpp"
+
+namespace apf {
+class Field;
+}
+
+namespace goal {
+
+using Teuchos::RCP;
+
+template <typename T> class Soln;
+
+class Indicator : public Integrator {
+  public:
+    Indicator(RCP<Integrator> u, apf::Field* e);
+    void in_elem(apf::MeshElement* me);
+    void out_elem();
+  private:
+    RCP<Soln<ST>> u;
+    apf::Field* error;
+    apf::MeshEntity* elem;
+};
+
+}
+
+#endif
@@ -1,46 +1,211 @@
-#include <BelosBlockGmresSolMgr.hpp>
+#include <Amesos2.hpp>
 #include <BelosLinearProblem.hpp>
+#include <BelosSolverFactory.hpp>
 #include <BelosTpetraAdapter.hpp>
 #include <MueLu.hpp>
 #include <MueLu_TpetraOperator.hpp>
 #include <MueLu_CreateTpetraPreconditioner.hpp>
+#include <Teuchos_CommHelpers.hpp>
+#include <Teuchos_ScalarTraits.hpp>
+#include <Teuchos_YamlParameterListCoreHelpers.hpp>
+#include <PCU.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include "goal_control.hpp"
 #include "goal_disc.hpp"
 #include "goal_linear_solve.hpp"
+#include "goal_multigrid.hpp"
 
 namespace goal {
 
+using Teuchos::rcp;
+
 typedef Tpetra::MultiVector<ST, LO, GO, KNode> MV;
 typedef Tpetra::Operator<ST, LO, GO, KNode> OP;
 typedef Tpetra::RowMatrix<ST, LO, GO, KNode> RM;
 typedef Belos::LinearProblem<ST, MV, OP> LinearProblem;
 typedef Belos::SolverManager<ST, MV, OP> Solver;
-typedef Belos::BlockGmresSolMgr<ST, MV, OP> GmresSolver;
-typedef Tpetra::Operator<ST, LO, GO, KNode> Prec;
+typedef Belos::SolverFactory<ST, MV, OP> SolverFactory;
+typedef MueLu::TpetraOperator<ST, LO, GO, KNode> MueLuOp;
+
+#ifdef GOAL_ENABLE_MIXED_PRECISION
+
+typedef float SPT;
+typedef Tpetra::MultiVector<SPT, LO, GO, KNode> MVSP;
+typedef Tpetra::Operator<SPT, LO, GO, KNode> OPSP;
+typedef MueLu::TpetraOperator<SPT, LO, GO, KNode> MueLuOpSP;
+
+class MixedPrec : public OP {
+  public:
+    MixedPrec(RCP<MueLuOpSP> p) : prec(p) {}
+    RCP<const MapT> getDomainMap() const { return prec->getDomainMap(); }
+    RCP<const MapT> getRangeMap() const { return prec->getRangeMap(); }
+    RCP<MueLuOpSP> get_prec() { return prec; }
+    void apply(
+        MV const& X,
+        MV& Y,
+        Teuchos::ETransp mode = Teuchos::NO_TRANS,
+        ST alpha = Teuchos::ScalarTraits<ST>::one(),
+        ST beta = Teuchos::ScalarTraits<ST>::zero()) const {
+      auto n = X.getNumVectors();
+      if (Teuchos::is_null(xs) || xs->getNumVectors() != n) {
+        xs = rcp(new MVSP(prec->getDomainMap(), n));
+        ys = rcp(new MVSP(prec->getRangeMap(), n));
+      }
+      Tpetra::deep_copy(*xs, X);
+      prec->apply(*xs, *ys, mode);
+      if (alpha == 1.0 && beta == 0.0) {
+        Tpetra::deep_copy(Y, *ys);
+      }
+      else {
+        MV tmp(Y.getMap(), n, false);
+        Tpetra::deep_copy(tmp, *ys);
+        Y.update(alpha, tmp, beta);
+      }
+    }
+  private:
+    RCP<MueLuOpSP> prec;
+    mutable RCP<MVSP> xs;
+    mutable RCP<MVSP> ys;
+};
+
+#endif
+
+enum PrecType { ALGEBRAIC, GEOMETRIC };
+enum PrecReuse { REUSE_NONE, REUSE_AGGREGATES, REUSE_FULL };
+enum Method {
+  BLOCK_GMRES, GMRES, CG, BLOCK_CG, PIPELINED_CG, GCRODR, RCG, DIRECT };
 
 static ParameterList get_valid_params() {
   ParameterList p;
+  p.set<std::string>("method", "");
+  p.set<std::string>("capture", "");
+  p.set<std::string>("direct solver", "");
+  p.set<bool>("factorization reuse", false);
   p.set<int>("krylov size", 0);
+  p.set<int>("recycle size", 0);
   p.set<int>("max iters", 0);
   p.set<double>("tolerance", 0.0);
   p.set<int>("output frequency", 0);
   p.set<int>("nonlinear max iters", 0);
   p.set<double>("nonlinear tolerance", 0.0);
+  p.set<std::string>("preconditioner", "");
+  p.set<std::string>("preconditioner reuse", "");
+  p.set<int>("smoother sweeps", 0);
+  p.set<double>("smoother damping", 0.0);
+  p.set<bool>("mixed precision", false);
+  p.set<bool>("auto tune", false);
+  p.set<int>("tune iters", 0);
+  p.set<int>("refinement iters", 0);
   p.sublist("multigrid");
   return p;
 }
 
-static ParameterList get_belos_params(ParameterList const& in) {
+static int get_prec_type(ParameterList const& p) {
+  if (! p.isParameter("preconditioner")) return ALGEBRAIC;
+  int type = ALGEBRAIC;
+  auto t = p.get<std::string>("preconditioner");
+  if (t == "algebraic") type = ALGEBRAIC;
+  else if (t == "geometric") type = GEOMETRIC;
+  else fail("unknown preconditioner: %s", t.c_str());
+  return type;
+}
+
+static int get_reuse(ParameterList const& p) {
+  if (! p.isParameter("preconditioner reuse")) return REUSE_NONE;
+  int reuse = REUSE_NONE;
+  auto r = p.get<std::string>("preconditioner reuse");
+  if (r == "none") reuse = REUSE_NONE;
+  else if (r == "aggregates") reuse = REUSE_AGGREGATES;
+  else if (r == "full") reuse = REUSE_FULL;
+  else fail("unknown preconditioner reuse: %s", r.c_str());
+  return reuse;
+}
+
+static int get_method(ParameterList const& p) {
+  if (! p.isParameter("method")) return BLOCK_GMRES;
+  int method = BLOCK_GMRES;
+  auto m = p.get<std::string>("method");
+  if (m == "block gmres") method = BLOCK_GMRES;
+  else if (m == "gmres") method = GMRES;
+  else if (m == "cg") method = CG;
+  else if (m == "block cg") method = BLOCK_CG;
+  else if (m == "pipelined cg") method = PIPELINED_CG;
+  else if (m == "gcrodr") method = GCRODR;
+  else if (m == "rcg") method = RCG;
+  else if (m == "direct") method = DIRECT;
+  else fail("unknown linear solve method: %s", m.c_str());
+  return method;
+}
+
+static std::string get_belos_name(const int method) {
+  std::string name;
+  if (method == BLOCK_GMRES) name = "Block GMRES";
+  else if (method == GMRES) name = "Pseudoblock GMRES";
+  else if (method == CG) name = "Pseudoblock CG";
+  else if (method == BLOCK_CG) name = "Block CG";
+  else if (method == PIPELINED_CG) name = "Block CG";
+  else if (method == GCRODR) name = "GCRODR";
+  else if (method == RCG) name = "RCG";
+  else fail("unknown linear solve method: %d", method);
+  return name;
+}
+
+static bool is_gmres(const int method) {
+  return (method == BLOCK_GMRES) || (method == GMRES);
+}
+
+static bool is_recycling(const int method) {
+  return (method == GCRODR) || (method == RCG);
+}
+
+using Candidate = std::pair<std::string, ParameterList>;
+
+static std::vector<Candidate> get_candidates(ParameterList const& base) {
+  std::vector<Candidate> c(5, Candidate("given", base));
+  c[1].first = "chebyshev smoother";
+  c[1].second.set<std::string>("smoother: type", "CHEBYSHEV");
+  c[1].second.remove("smoother: params", false);
+  c[2].first = "symmetric gauss-seidel smoother";
+  c[2].second.set<std::string>("smoother: type", "RELAXATION");
+  c[2].second.remove("smoother: params", false);
+  c[2].second.sublist("smoother: params").set<std::string>(
+      "relaxation: type", "Symmetric Gauss-Seidel");
+  c[3].first = "aggregation drop tolerance";
+  c[3].second.set<double>("aggregation: drop tol", 0.02);
+  c[4].first = "relaxation coarse solver";
+  c[4].second.set<std::string>("coarse: type", "RELAXATION");
+  return c;
+}
+
+static ParameterList get_belos_params(
+    ParameterList const& in,
+    const int method,
+    const int num_rhs) {
   ParameterList p;
   int max_iters = in.get<int>("max iters");
-  int krylov = in.get<int>("krylov size");
   double tol = in.get<double>("tolerance");
-  p.set<int>("Block Size" , 1);
-  p.set<int>("Num Blocks", krylov);
   p.set<int>("Maximum Iterations", max_iters);
   p.set<double>("Convergence Tolerance", tol);
-  p.set<std::string>("Orthogonalization", "DGKS");
+  if (method == PIPELINED_CG) {
+    p.set<int>("Block Size", 1);
+    p.set<bool>("Use Single Reduction", true);
+  }
+  else if (method == BLOCK_GMRES || method == BLOCK_CG) {
+    p.set<int>("Block Size", num_rhs);
+  }
+  if (is_gmres(method) || is_recycling(method)) {
+    int krylov = in.get<int>("krylov size");
+    p.set<int>("Num Blocks", krylov);
+  }
+  if (is_recycling(method)) {
+    int recycle = in.get<int>("recycle size");
+    p.set<int>("Num Recycled Blocks", recycle);
+  }
+  if (method != CG && method != PIPELINED_CG && method != RCG)
+    p.set<std::string>("Orthogonalization", "DGKS");
   if (in.isType<int>("output frequency")) {
     int f = in.get<int>("output frequency");
     p.set<int>("Verbosity", 33);
@@ -50,41 +215,349 @@ static ParameterList get_belos_params(ParameterList const& in) {
   return p;
 }
 
-static RCP<Solver> build_solver(
-    ParameterList const& in,
+LinearSolver::LinearSolver(ParameterList const& p) {
+  params = p;
+  params.validateParameters(get_valid_params(), 0);
+  reuse = get_reuse(params);
+  method = get_method(params);
+  prec_type = get_prec_type(params);
+  if (prec_type == GEOMETRIC) {
+    params.get<int>("smoother sweeps", 2);
+    params.get<double>("smoother damping", 2.0 / 3.0);
+  }
+  mixed = params.get<bool>("mixed precision", false);
+  tune = params.get<bool>("auto tune", false);
+  keep_factors = params.get<bool>("factorization reuse", false);
+  tuned = false;
+  num_solves = 0;
+  stats = {0, false, 0.0, 0.0};
+#ifndef GOAL_ENABLE_MIXED_PRECISION
+  if (mixed)
+    fail("mixed precision requires GOAL_ENABLE_MIXED_PRECISION");
+#endif
+}
+
+LinearSolver::~LinearSolver() {
+  reset();
+}
+
+bool LinearSolver::is_geometric() const {
+  return (prec_type == GEOMETRIC) && (method != DIRECT);
+}
+
+void LinearSolver::reset() {
+  prec = Teuchos::null;
+  prec_graph = Teuchos::null;
+  direct = Teuchos::null;
+  direct_graph = Teuchos::null;
+  direct_vals.clear();
+  recycler = Teuchos::null;
+  recycle_map = Teuchos::null;
+}
+
+/* compares and then stores a copy of every local nonzero, so this
+   costs one extra pass over A and nnz extra scalars per solve. it is
+   only called when "factorization reuse" is set. */
+
+bool LinearSolver::same_values(RCP<MatrixT> A) {
+  Teuchos::ArrayView<const LO> cols;
+  Teuchos::ArrayView<const ST> vals;
+  int same = (direct_vals.size() == A->getNodeNumEntries());
+  size_t k = 0;
+  for (LO row = 0; same && row < LO(A->getNodeNumRows()); ++row) {
+    A->getLocalRowView(row, cols, vals);
+    for (LO j = 0; same && j < vals.size(); ++j)
+      same = (direct_vals[k++] == vals[j]);
+  }
+  Teuchos::reduceAll(
+      *(A->getComm()), Teuchos::REDUCE_MIN, same, Teuchos::outArg(same));
+  if (same) return true;
+  direct_vals.resize(A->getNodeNumEntries());
+  k = 0;
+  for (LO row = 0; row < LO(A->getNodeNumRows()); ++row) {
+    A->getLocalRowView(row, cols, vals);
+    for (LO j = 0; j < vals.size(); ++j)
+      direct_vals[k++] = vals[j];
+  }
+  return false;
+}
+
+void LinearSolver::direct_solve(
     RCP<MatrixT> A,
-    RCP<VectorT> x,
-    RCP<VectorT> b,
-    Disc* d) {
-  Teuchos::ParameterList mg_params(in.sublist("multigrid"));
-  auto belos_params = get_belos_params(in);
+    RCP<MultiVectorT> x,
+    RCP<MultiVectorT> b) {
+  auto t0 = time();
+  auto graph = A->getCrsGraph();
+  bool same_graph =
+    Teuchos::nonnull(direct) && (graph.get() == direct_graph.get());
+  if (! same_graph) {
+    auto name = params.get<std::string>("direct solver", "KLU2");
+    if (! Amesos2::query(name))
+      fail("unavailable direct solver: %s", name.c_str());
+    direct = Amesos2::create<MatrixT, MultiVectorT>(name, A);
+    direct_graph = graph;
+    direct_vals.clear();
+    direct->symbolicFactorization();
+    if (keep_factors) same_values(A);
+    direct->numericFactorization();
+  }
+  else if (keep_factors && same_values(A)) {
+    direct->setA(A, Amesos2::NUMFACT);
+    print(" > linear system: reusing factorization");
+  }
+  else {
+    direct->setA(A, Amesos2::SYMBFACT);
+    direct->numericFactorization();
+    print(" > linear system: reusing symbolic factorization");
+  }
+  auto t1 = time();
+  print(" > linear system: factored in %f seconds", t1 - t0);
+  direct->solve(x.ptr(), b.ptr());
+  auto t2 = time();
+  stats = {0, true, t1 - t0, t2 - t1};
+  print(" > linear system: solved in %f seconds", t2 - t1);
+}
+
+#ifdef GOAL_ENABLE_MIXED_PRECISION
+
+void LinearSolver::build_mixed_prec(RCP<MatrixT> A, RCP<MultiVectorT>) {
+  auto graph = A->getCrsGraph();
+  bool same = Teuchos::nonnull(prec) && (graph.get() == prec_graph.get());
+  if (same && reuse == REUSE_FULL) {
+    print(" > linear system: reusing preconditioner");
+  }
+  else if (same && reuse == REUSE_AGGREGATES) {
+    auto M = Teuchos::rcp_dynamic_cast<MixedPrec>(prec, true);
+    auto As = A->convert<SPT>();
+    MueLu::ReuseTpetraPreconditioner(As, *(M->get_prec()));
+    print(" > linear system: reusing aggregates");
+  }
+  else {
+    ParameterList mg_params(params.sublist("multigrid"));
+    if (reuse == REUSE_AGGREGATES)
+      mg_params.set<std::string>("reuse: type", "RP");
+    auto As = (RCP<OPSP>)A->convert<SPT>();
+    auto P = MueLu::CreateTpetraPreconditioner(As, mg_params);
+    prec = rcp(new MixedPrec(P));
+    prec_graph = graph;
+  }
+}
+
+#else
+
+void LinearSolver::build_mixed_prec(RCP<MatrixT>, RCP<MultiVectorT>) {
+  fail("mixed precision requires GOAL_ENABLE_MIXED_PRECISION");
+}
+
+#endif
+
+void LinearSolver::build_geometric_prec(RCP<MatrixT> A) {
+  if (Teuchos::is_null(P))
+    fail("geometric preconditioner requires a prolongation operator");
+  auto graph = A->getCrsGraph();
+  bool same = Teuchos::nonnull(prec) && (graph.get() == prec_graph.get());
+  if (same && reuse == REUSE_FULL) {
+    print(" > linear system: reusing preconditioner");
+  }
+  else {
+    prec = rcp(new TwoLevel(A, P, params));
+    prec_graph = graph;
+  }
+}
+
+void LinearSolver::build_prec(RCP<MatrixT> A, RCP<MultiVectorT> coords) {
+  if (prec_type == GEOMETRIC) return build_geometric_prec(A);
+  if (mixed) return build_mixed_prec(A, coords);
   auto AA = (RCP<OP>)A;
-  auto coords = d->get_coords();
-  auto P = MueLu::CreateTpetraPreconditioner(AA, mg_params, coords);
-  auto problem = rcp(new LinearProblem(A, x, b));
-  problem->setLeftPrec(P);
-  problem->setProblem();
-  return rcp(new GmresSolver(problem, rcpFromRef(belos_params)));
+  auto graph = A->getCrsGraph();
+  bool same = Teuchos::nonnull(prec) && (graph.get() == prec_graph.get());
+  if (same && reuse == REUSE_FULL) {
+    print(" > linear system: reusing preconditioner");
+  }
+  else if (same && reuse == REUSE_AGGREGATES) {
+    auto P = Teuchos::rcp_dynamic_cast<MueLuOp>(prec, true);
+    MueLu::ReuseTpetraPreconditioner(A, *P);
+    print(" > linear system: reusing aggregates");
+  }
+  else {
+    ParameterList mg_params(params.sublist("multigrid"));
+    if (reuse == REUSE_AGGREGATES)
+      mg_params.set<std::string>("reuse: type", "RP");
+    prec = MueLu::CreateTpetraPreconditioner(AA, mg_params, coords);
+    prec_graph = graph;
+  }
 }
 
-void solve(
-    ParameterList const& in,
+void LinearSolver::capture(
+    RCP<MatrixT> A,
+    RCP<MultiVectorT> b,
+    RCP<MultiVectorT> coords) {
+  auto prefix = params.get<std::string>("capture");
+  auto name = prefix + "_" + std::to_string(num_solves);
+  print(" > linear system: capturing to %s", name.c_str());
+  MMWriterT::writeSparseFile(name + "_A.mm", A);
+  MMWriterT::writeDenseFile(name + "_b.mm", b);
+  if (Teuchos::nonnull(coords))
+    MMWriterT::writeDenseFile(name + "_coords.mm", coords);
+  ParameterList p(params);
+  p.remove("capture");
+  if (PCU_Comm_Self()) return;
+  Teuchos::writeParameterListToYamlFile(p, name + "_params.yaml");
+}
+
+static double get_min_reduction(
+    RCP<MatrixT> A,
+    RCP<MultiVectorT> x,
+    RCP<MultiVectorT> b,
+    Teuchos::Array<ST> const& r0) {
+  MV r(*b, Teuchos::Copy);
+  A->apply(*x, r, Teuchos::NO_TRANS, -1.0, 1.0);
+  Teuchos::Array<ST> r1(r0.size());
+  r.norm2(r1());
+  double reduction = std::numeric_limits<double>::max();
+  for (int i = 0; i < r0.size(); ++i)
+    if (r1[i] > 0.0) reduction = std::min(reduction, r0[i] / r1[i]);
+  return reduction;
+}
+
+/* each candidate gets a short trial capped at "tune iters" iterations.
+   candidates are ranked by setup time plus the trial's time per decade
+   of residual reduction, scaled to the decades the tolerance asks for.
+   the real solve then runs once with the winner's preconditioner. */
+
+void LinearSolver::auto_tune(
+    RCP<MatrixT> A,
+    RCP<MultiVectorT> x,
+    RCP<MultiVectorT> b,
+    RCP<MultiVectorT> coords) {
+  auto candidates = get_candidates(params.sublist("multigrid"));
+  int trial_iters = params.get<int>("tune iters", 10);
+  double decades = -std::log10(params.get<double>("tolerance"));
+  Teuchos::Array<ST> r0(b->getNumVectors());
+  {
+    MV r(*b, Teuchos::Copy);
+    A->apply(*x, r, Teuchos::NO_TRANS, -1.0, 1.0);
+    r.norm2(r0());
+  }
+  int best = -1;
+  double best_time = std::numeric_limits<double>::max();
+  RCP<OperatorT> best_prec;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    params.set("multigrid", candidates[i].second);
+    reset();
+    auto xi = rcp(new MV(*x, Teuchos::Copy));
+    int iters = 0;
+    auto t0 = time();
+    build_prec(A, coords);
+    auto t1 = time();
+    krylov_solve(A, xi, b, iters, trial_iters);
+    auto t2 = time();
+    double digits = std::log10(get_min_reduction(A, xi, b, r0));
+    double total = std::numeric_limits<double>::max();
+    if (digits > 0.0) total = (t1 - t0) + (t2 - t1) / digits * decades;
+    print(" > auto tune: %s: setup %f trial %f decades %f estimate %f",
+        candidates[i].first.c_str(), t1 - t0, t2 - t1, digits, total);
+    if (best >= 0 && total >= best_time) continue;
+    best = i;
+    best_time = total;
+    best_prec = prec;
+  }
+  reset();
+  tuned = true;
+  params.set("multigrid", candidates[best].second);
+  prec = best_prec;
+  prec_graph = A->getCrsGraph();
+  print(" > auto tune: selected %s", candidates[best].first.c_str());
+}
+
+void LinearSolver::solve(
     RCP<MatrixT> A,
-    RCP<VectorT> x,
-    RCP<VectorT> b,
+    RCP<MultiVectorT> x,
+    RCP<MultiVectorT> b,
     Disc* d) {
-  in.validateParameters(get_valid_params(), 0);
-  auto solver = build_solver(in, A, x, b, d);
-  auto dofs = solver->getProblem().getRHS()->getGlobalLength();
+  solve(A, x, b, d->get_coords());
+}
+
+void LinearSolver::solve(
+    RCP<MatrixT> A,
+    RCP<MultiVectorT> x,
+    RCP<MultiVectorT> b,
+    RCP<MultiVectorT> coords) {
+  auto dofs = b->getGlobalLength();
+  auto nrhs = b->getNumVectors();
   print(" > linear system: num dofs %zu", dofs);
+  if (nrhs > 1) print(" > linear system: num rhs %zu", nrhs);
+  if (params.isParameter("capture")) capture(A, b, coords);
+  ++num_solves;
+  if (method == DIRECT) return direct_solve(A, x, b);
   auto t0 = time();
-  solver->solve();
+  if (tune && (! tuned)) auto_tune(A, x, b, coords);
+  else build_prec(A, coords);
   auto t1 = time();
-  auto iters = solver->getNumIters();
+  print(" > linear system: setup in %f seconds", t1 - t0);
+  int iters = 0;
+  auto t2 = time();
+  bool converged = krylov_solve(A, x, b, iters);
+  int refine_iters = params.get<int>("refinement iters", 0);
+  for (int i = 0; i < refine_iters && (! converged); ++i) {
+    auto r = rcp(new MV(b->getMap(), nrhs));
+    auto e = rcp(new MV(x->getMap(), nrhs));
+    A->apply(*x, *r);
+    r->update(1.0, *b, -1.0);
+    converged = krylov_solve(A, e, r, iters);
+    x->update(1.0, *e, 1.0);
+    print(" > linear system: refinement step %d", i + 1);
+  }
+  auto t3 = time();
+  stats = {iters, converged, t1 - t0, t3 - t2};
   print(" > linear system: solved in %d iterations", iters);
-  if (iters >= in.get<int>("max iters"))
+  if (! converged)
     print(" >  but solve was incomplete! continuing anyway...");
-  print(" > linear system: solved in %f seconds", t1 - t0);
+  print(" > linear system: solved in %f seconds", t3 - t2);
+}
+
+bool LinearSolver::krylov_solve(
+    RCP<MatrixT> A,
+    RCP<MultiVectorT> x,
+    RCP<MultiVectorT> b,
+    int& iters,
+    const int max_iters) {
+  auto nrhs = b->getNumVectors();
+  auto belos_params = get_belos_params(params, method, nrhs);
+  if (max_iters > 0)
+    belos_params.set<int>("Maximum Iterations", max_iters);
+  auto problem = rcp(new LinearProblem(A, x, b));
+  problem->setLeftPrec(prec);
+  problem->setProblem();
+  RCP<Solver> solver;
+  auto map = A->getRowMap();
+  bool recycle = is_recycling(method);
+  bool same = Teuchos::nonnull(recycler) && (map.get() == recycle_map.get());
+  if (recycle && same) {
+    solver = recycler;
+    print(" > linear system: recycling krylov subspace");
+  }
+  else {
+    SolverFactory factory;
+    auto name = get_belos_name(method);
+    solver = factory.create(name, rcp(new ParameterList(belos_params)));
+  }
+  if (recycle) {
+    recycler = solver;
+    recycle_map = map;
+  }
+  solver->setProblem(problem);
+  auto result = solver->solve();
+  iters += solver->getNumIters();
+  return result == Belos::Converged;
+}
+
+LinearSolver* create_linear_solver(ParameterList const& p) {
+  return new LinearSolver(p);
+}
+
+void destroy_linear_solver(LinearSolver* l) {
+  delete l;
 }
 
 }
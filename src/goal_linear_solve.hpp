@@ -1,8 +1,18 @@
 #ifndef goal_linear_solve_hpp
 #define goal_linear_solve_hpp
 
+#include <vector>
+
 #include "goal_data_types.hpp"
 
+namespace Amesos2 {
+template <class Matrix, class Vector> class Solver;
+}
+
+namespace Belos {
+template <class S, class MV, class OP> class SolverManager;
+}
+
 namespace goal {
 
 using Teuchos::RCP;
@@ -10,12 +20,77 @@ using Teuchos::ParameterList;
 
 class Disc;
 
-void solve(
-    ParameterList const& p,
-    RCP<MatrixT> A,
-    RCP<VectorT> x,
-    RCP<VectorT> b,
-    Disc* d);
+struct LinearStats {
+  int iters;
+  bool converged;
+  double setup_time;
+  double solve_time;
+};
+
+class LinearSolver {
+  public:
+    LinearSolver(ParameterList const& p);
+    ~LinearSolver();
+    void solve(
+        RCP<MatrixT> A,
+        RCP<MultiVectorT> x,
+        RCP<MultiVectorT> b,
+        Disc* d);
+    void solve(
+        RCP<MatrixT> A,
+        RCP<MultiVectorT> x,
+        RCP<MultiVectorT> b,
+        RCP<MultiVectorT> coords);
+    void reset();
+    LinearStats const& get_stats() const { return stats; }
+    bool is_geometric() const;
+    void set_prolongation(RCP<MatrixT> P_) { P = P_; }
+  private:
+    void build_prec(RCP<MatrixT> A, RCP<MultiVectorT> coords);
+    void build_mixed_prec(RCP<MatrixT> A, RCP<MultiVectorT> coords);
+    void build_geometric_prec(RCP<MatrixT> A);
+    bool same_values(RCP<MatrixT> A);
+    void direct_solve(
+        RCP<MatrixT> A,
+        RCP<MultiVectorT> x,
+        RCP<MultiVectorT> b);
+    bool krylov_solve(
+        RCP<MatrixT> A,
+        RCP<MultiVectorT> x,
+        RCP<MultiVectorT> b,
+        int& iters,
+        const int max_iters = 0);
+    void auto_tune(
+        RCP<MatrixT> A,
+        RCP<MultiVectorT> x,
+        RCP<MultiVectorT> b,
+        RCP<MultiVectorT> coords);
+    void capture(
+        RCP<MatrixT> A,
+        RCP<MultiVectorT> b,
+        RCP<MultiVectorT> coords);
+    ParameterList params;
+    LinearStats stats;
+    int num_solves;
+    int reuse;
+    int method;
+    int prec_type;
+    bool mixed;
+    bool tune;
+    bool tuned;
+    bool keep_factors;
+    RCP<OperatorT> prec;
+    RCP<const GraphT> prec_graph;
+    RCP<MatrixT> P;
+    RCP<Belos::SolverManager<ST, MultiVectorT, OperatorT> > recycler;
+    RCP<const MapT> recycle_map;
+    RCP<Amesos2::Solver<MatrixT, MultiVectorT> > direct;
+    RCP<const GraphT> direct_graph;
+    std::vector<ST> direct_vals;
+};
+
+LinearSolver* create_linear_solver(ParameterList const& p);
+void destroy_linear_solver(LinearSolver* l);
 
 }
 
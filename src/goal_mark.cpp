@@ -0,0 +1,149 @@
+#include <apf.h>
+#include <apfMesh2.h>
+#include <Kokkos_Core.hpp>
+#include <PCU.h>
+
+#include "goal_control.hpp"
+#include "goal_mark.hpp"
+
+namespace goal {
+
+EdgeMarks::EdgeMarks(apf::Mesh2* m) :
+    ma::IdentitySizeField(m) {
+  mesh = m;
+  tag = mesh->createIntTag("goal_edge_mark", 1);
+}
+
+EdgeMarks::~EdgeMarks() {
+  apf::removeTagFromDimension(mesh, tag, 1);
+  mesh->destroyTag(tag);
+}
+
+bool EdgeMarks::shouldSplit(apf::MeshEntity* edge) {
+  return mesh->hasTag(edge, tag);
+}
+
+bool EdgeMarks::is_marked(apf::MeshEntity* edge) {
+  return mesh->hasTag(edge, tag);
+}
+
+void EdgeMarks::mark(apf::MeshEntity* edge) {
+  int one = 1;
+  mesh->setIntTag(edge, tag, &one);
+}
+
+void EdgeMarks::synchronize() {
+  PCU_Comm_Begin();
+  apf::MeshEntity* edge;
+  apf::MeshIterator* edges = mesh->begin(1);
+  while ((edge = mesh->iterate(edges))) {
+    if (! (mesh->isShared(edge) && is_marked(edge))) continue;
+    apf::Copies remotes;
+    mesh->getRemotes(edge, remotes);
+    APF_ITERATE(apf::Copies, remotes, it)
+      PCU_COMM_PACK(it->first, it->second);
+  }
+  mesh->end(edges);
+  PCU_Comm_Send();
+  while (PCU_Comm_Receive()) {
+    apf::MeshEntity* remote;
+    PCU_COMM_UNPACK(remote);
+    mark(remote);
+  }
+}
+
+void find_longest_edges(
+    const int num_elems,
+    const int num_elem_edges,
+    const int* elem_edges,
+    const double* lengths,
+    int* longest) {
+  using Policy = Kokkos::RangePolicy<Kokkos::DefaultHostExecutionSpace>;
+  auto f = [=] (const int elem) {
+    const int* edges = elem_edges + elem * num_elem_edges;
+    int max = edges[0];
+    for (int i = 1; i < num_elem_edges; ++i)
+      if (lengths[edges[i]] > lengths[max])
+        max = edges[i];
+    longest[elem] = max;
+  };
+  Kokkos::parallel_for(Policy(0, num_elems), f);
+}
+
+void mark_long_edges(apf::Mesh2* m, EdgeMarks* marks) {
+  int dim = m->getDimension();
+  int num_elems = m->count(dim);
+  int type = apf::Mesh::simplexTypes[dim];
+  int num_elem_edges = apf::Mesh::adjacentCount[type][1];
+  auto idx_tag = m->createIntTag("goal_edge_idx", 1);
+  std::vector<apf::MeshEntity*> edges(m->count(1));
+  std::vector<double> lengths(edges.size());
+  std::vector<int> elem_edges(num_elems * num_elem_edges);
+  std::vector<int> longest(num_elems);
+  int idx = 0;
+  apf::MeshEntity* edge;
+  apf::MeshIterator* it = m->begin(1);
+  while ((edge = m->iterate(it))) {
+    m->setIntTag(edge, idx_tag, &idx);
+    edges[idx] = edge;
+    lengths[idx++] = apf::measure(m, edge);
+  }
+  m->end(it);
+  int k = 0;
+  apf::Downward down;
+  apf::MeshEntity* elem;
+  it = m->begin(dim);
+  while ((elem = m->iterate(it))) {
+    int nedges = m->getDownward(elem, 1, down);
+    GOAL_DEBUG_ASSERT(nedges == num_elem_edges);
+    for (int i = 0; i < nedges; ++i)
+      m->getIntTag(down[i], idx_tag, &elem_edges[k++]);
+  }
+  m->end(it);
+  apf::removeTagFromDimension(m, idx_tag, 1);
+  m->destroyTag(idx_tag);
+  find_longest_edges(
+      num_elems, num_elem_edges, elem_edges.data(), lengths.data(),
+      longest.data());
+  for (int elem = 0; elem < num_elems; ++elem)
+    marks->mark(edges[longest[elem]]);
+}
+
+static bool needs_marking(
+    apf::Mesh2* m,
+    apf::MeshTag* elem_tag,
+    apf::Adjacent& elems) {
+  for (size_t i = 0; i < elems.getSize(); ++i)
+    if (m->hasTag(elems[i], elem_tag))
+      return false;
+  return true;
+}
+
+void mark_single_edges(apf::Mesh2* m, EdgeMarks* marks) {
+  int one = 1;
+  int dim = m->getDimension();
+  auto elem_tag = m->createIntTag("goal_elem_mark", 1);
+  apf::Adjacent elems;
+  apf::MeshEntity* edge;
+  apf::MeshIterator* edges = m->begin(1);
+  while ((edge = m->iterate(edges))) {
+    m->getAdjacent(edge, dim, elems);
+    if (! needs_marking(m, elem_tag, elems)) continue;
+    marks->mark(edge);
+    for (size_t i = 0; i < elems.getSize(); ++i)
+      m->setIntTag(elems[i], elem_tag, &one);
+  }
+  m->end(edges);
+  apf::removeTagFromDimension(m, elem_tag, dim);
+  m->destroyTag(elem_tag);
+}
+
+EdgeMarks* create_edge_marks(apf::Mesh2* m) {
+  return new EdgeMarks(m);
+}
+
+void destroy_edge_marks(EdgeMarks* m) {
+  delete m;
+}
+
+}
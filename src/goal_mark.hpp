@@ -0,0 +1,38 @@
+#ifndef goal_mark_hpp
+#define goal_mark_hpp
+
+#include <ma.h>
+
+namespace goal {
+
+class EdgeMarks : public ma::IdentitySizeField {
+  public:
+    EdgeMarks(apf::Mesh2* m);
+    ~EdgeMarks();
+    bool shouldSplit(apf::MeshEntity* edge);
+    bool is_marked(apf::MeshEntity* edge);
+    void mark(apf::MeshEntity* edge);
+    void synchronize();
+  private:
+    apf::Mesh2* mesh;
+    apf::MeshTag* tag;
+};
+
+using EdgeMarker = void (*)(apf::Mesh2* m, EdgeMarks* marks);
+
+void find_longest_edges(
+    const int num_elems,
+    const int num_elem_edges,
+    const int* elem_edges,
+    const double* lengths,
+    int* longest);
+
+void mark_long_edges(apf::Mesh2* m, EdgeMarks* marks);
+void mark_single_edges(apf::Mesh2* m, EdgeMarks* marks);
+
+EdgeMarks* create_edge_marks(apf::Mesh2* m);
+void destroy_edge_marks(EdgeMarks* m);
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include <MueLu.hpp>
+#include <MueLu_CreateTpetraPreconditioner.hpp>
+#include <TpetraExt_MatrixMatrix.hpp>
+
+#include "goal_control.hpp"
+#include "goal_multigrid.hpp"
+
+namespace goal {
+
+using Teuchos::rcp;
+
+TwoLevel::TwoLevel(
+    RCP<MatrixT> A_,
+    RCP<MatrixT> P_,
+    ParameterList const& p) {
+  A = A_;
+  P = P_;
+  sweeps = p.get<int>("smoother sweeps");
+  damping = p.get<double>("smoother damping");
+  dinv = rcp(new VectorT(A->getRowMap()));
+  A->getLocalDiagCopy(*dinv);
+  dinv->reciprocal(*dinv);
+  build_coarse(p);
+}
+
+void TwoLevel::build_coarse(ParameterList const& p) {
+  auto t0 = time();
+  auto AP = rcp(new MatrixT(A->getRowMap(), 0));
+  Tpetra::MatrixMatrix::Multiply(*A, false, *P, false, *AP);
+  Ac = rcp(new MatrixT(P->getDomainMap(), 0));
+  Tpetra::MatrixMatrix::Multiply(*P, true, *AP, false, *Ac);
+  ParameterList mg_params(p.sublist("multigrid"));
+  coarse = MueLu::CreateTpetraPreconditioner((RCP<OperatorT>)Ac, mg_params);
+  auto t1 = time();
+  print(" > geometric mg: coarse dofs %zu", Ac->getGlobalNumRows());
+  print(" > geometric mg: coarse setup in %f seconds", t1 - t0);
+}
+
+void TwoLevel::smooth(MultiVectorT const& b, MultiVectorT& x) const {
+  MultiVectorT r(b.getMap(), b.getNumVectors(), false);
+  for (int s = 0; s < sweeps; ++s) {
+    A->apply(x, r);
+    r.update(1.0, b, -1.0);
+    x.elementWiseMultiply(damping, *dinv, r, 1.0);
+  }
+}
+
+void TwoLevel::apply(
+    MultiVectorT const& X,
+    MultiVectorT& Y,
+    Teuchos::ETransp mode,
+    ST alpha,
+    ST beta) const {
+  GOAL_DEBUG_ASSERT(mode == Teuchos::NO_TRANS);
+  (void)mode;
+  auto n = X.getNumVectors();
+  auto coarse_map = P->getDomainMap();
+  MultiVectorT z(A->getRangeMap(), n);
+  MultiVectorT r(A->getRangeMap(), n, false);
+  MultiVectorT rc(coarse_map, n, false);
+  MultiVectorT ec(coarse_map, n);
+  smooth(X, z);
+  A->apply(z, r);
+  r.update(1.0, X, -1.0);
+  P->apply(r, rc, Teuchos::TRANS);
+  coarse->apply(rc, ec);
+  P->apply(ec, z, Teuchos::NO_TRANS, 1.0, 1.0);
+  smooth(X, z);
+  Y.update(alpha, z, beta);
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef goal_multigrid_hpp
+#define goal_multigrid_hpp
+
+#include "goal_data_types.hpp"
+
+namespace goal {
+
+using Teuchos::RCP;
+using Teuchos::ParameterList;
+
+class TwoLevel : public OperatorT {
+  public:
+    TwoLevel(
+        RCP<MatrixT> A,
+        RCP<MatrixT> P,
+        ParameterList const& p);
+    RCP<const MapT> getDomainMap() const { return A->getDomainMap(); }
+    RCP<const MapT> getRangeMap() const { return A->getRangeMap(); }
+    void apply(
+        MultiVectorT const& X,
+        MultiVectorT& Y,
+        Teuchos::ETransp mode = Teuchos::NO_TRANS,
+        ST alpha = Teuchos::ScalarTraits<ST>::one(),
+        ST beta = Teuchos::ScalarTraits<ST>::zero()) const;
+  private:
+    void smooth(MultiVectorT const& b, MultiVectorT& x) const;
+    void build_coarse(ParameterList const& p);
+    RCP<MatrixT> A;
+    RCP<MatrixT> P;
+    RCP<MatrixT> Ac;
+    RCP<VectorT> dinv;
+    RCP<OperatorT> coarse;
+    int sweeps;
+    double damping;
+};
+
+}
+
+#endif
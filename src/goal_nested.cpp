@@ -1,99 +1,275 @@
+#include <algorithm>
 #include <apfMDS.h>
 #include <apfMesh2.h>
 #include <apfNumbering.h>
 #include <apfShape.h>
 #include <ma.h>
+#include <PCU.h>
 
+#include "goal_balance.hpp"
 #include "goal_control.hpp"
+#include "goal_mark.hpp"
 #include "goal_nested.hpp"
 
 namespace goal {
 
+/* everything that reads the base mesh, touches Teuchos/Tpetra or
+   dispatches Kokkos happens here, on the calling thread. refine() only
+   works on the nested mesh copy, so it may run on a helper thread. */
 
-Nested::Nested(Disc* d, const int m) {
-  double t0 = time();
+Nested::Nested(Disc* d, const int m, const bool b, RCP<const Comm> c) {
   mode = m;
+  marks = 0;
+  comm = c;
   is_base = false;
   sets = d->get_model_sets();
   base_mesh = d->get_apf_mesh();
+  verify = d->get_verify();
+  GOAL_DEBUG_ASSERT(! (b && d->has_data()));
+  if (b && (mode == LONG || mode == SINGLE)) d->mesh_changed();
+  if (b && mode == LONG) balance_base(mark_long_edges);
+  if (b && mode == SINGLE) balance_base(mark_single_edges);
+  compute_signature();
   base_ve_nmbr = 0;
   nested_ve_nmbr = 0;
   nested_nmbr = 0;
-  create_base_map();
-  create_nested_mesh();
+  z_fine = 0;
+  z_coarse = 0;
+  if (mode == QUADRATIC) {
+    enrich_mesh();
+  }
+  else {
+    create_base_map();
+    create_nested_mesh();
+    mark_edges();
+  }
+  initialize();
+}
+
+void Nested::refine() {
+  if (mode == QUADRATIC) return;
+  GOAL_DEBUG_ASSERT(! nested_nmbr);
   initialize_nested_nmbr();
   refine_mesh();
-  initialize();
-  double t1 = time();
-  print(" > nested mesh built in %f seconds", t1 - t0);
+  compute_parents();
 }
 
 Nested::~Nested() {
-  apf::destroyGlobalNumbering(nested_nmbr);
+  if (marks) destroy_edge_marks(marks);
+  release_adjoint_fields();
 }
 
-void Nested::set_adjoint(RCP<VectorT> z) {
-  apf::DynamicArray<apf::Node> nodes;
-  apf::getNodes(nmbr, nodes);
-  auto data = z->get1dView();
-  auto zu = mesh->findField("zu");
-  for (size_t n = 0; n < nodes.size(); ++n) {
-    auto node = nodes[n];
-    auto ent = node.entity;
-    auto lnode = node.node;
-    if (! mesh->isOwned(ent)) continue;
-    GO row = get_gid(node, 0);
-    LO lrow = owned_map->getLocalElement(row);
-    double soln = data[lrow];
-    apf::setScalar(zu, ent, lnode, soln);
+void Nested::balance_base(EdgeMarker marker) {
+  int dim = base_mesh->getDimension();
+  auto marks = create_edge_marks(base_mesh);
+  marker(base_mesh, marks);
+  marks->synchronize();
+  auto weights = base_mesh->createDoubleTag("goal_nested_weight", 1);
+  apf::Downward edges;
+  apf::MeshEntity* elem;
+  apf::MeshIterator* elems = base_mesh->begin(dim);
+  while ((elem = base_mesh->iterate(elems))) {
+    double w = 1.0;
+    int nedges = base_mesh->getDownward(elem, 1, edges);
+    for (int e = 0; e < nedges; ++e)
+      if (marks->is_marked(edges[e])) w += 1.0;
+    base_mesh->setDoubleTag(elem, weights, &w);
   }
-  apf::synchronize(zu);
+  base_mesh->end(elems);
+  destroy_edge_marks(marks);
+  goal::balance(base_mesh, weights);
+  apf::removeTagFromDimension(base_mesh, weights, dim);
+  base_mesh->destroyTag(weights);
 }
 
-void Nested::transfer_adjoint() {
-  double zpress = 0.0;
-  apf::Vector3 zdisp(0,0,0);
-  auto P2 = apf::getSerendipity();
-  auto nested_zu = mesh->findField("zu");
-  auto nested_zp = mesh->findField("zp");
-  auto zu_fine = apf::createField(base_mesh, "zu_fine", apf::VECTOR, P2);
-  auto zp_fine = apf::createField(base_mesh, "zp_fine", apf::SCALAR, P2);
-  auto zu = apf::createFieldOn(base_mesh, "zu", apf::VECTOR);
-  auto zp = apf::createFieldOn(base_mesh, "zp", apf::SCALAR);
+void Nested::enrich_mesh() {
+  goal::print(" > nested: quadratic");
+  mesh = base_mesh;
+  owns_mesh = false;
+  shape = apf::getSerendipity();
+  nmbr_name = "nmbr_enriched";
+}
+
+static void add_prolongation_row(
+    RCP<MatrixT> P,
+    Disc* nested,
+    Disc* base,
+    apf::MeshEntity* ent,
+    apf::MeshEntity* base_ent) {
+  auto m = base->get_apf_mesh();
+  apf::Downward verts;
+  GO cols[2];
+  ST vals[2];
+  int nverts = 1;
+  verts[0] = base_ent;
+  if (m->getType(base_ent) != apf::Mesh::VERTEX)
+    nverts = m->getDownward(base_ent, 0, verts);
+  for (int eq = 0; eq < nested->get_num_eqs(); ++eq) {
+    GO row = nested->get_gid(apf::Node(ent, 0), eq);
+    for (int v = 0; v < nverts; ++v) {
+      cols[v] = base->get_gid(verts[v], 0, eq);
+      vals[v] = 1.0 / nverts;
+    }
+    P->insertGlobalValues(row, nverts, vals, cols);
+  }
+}
+
+RCP<MatrixT> Nested::build_prolongation(Disc* base) {
+  GOAL_DEBUG_ASSERT(base->has_data());
+  GOAL_DEBUG_ASSERT(base->get_apf_mesh() == base_mesh);
+  auto P = Teuchos::rcp(new MatrixT(owned_map, 2));
+  if (mode == QUADRATIC) {
+    for (int dim = 0; dim <= 1; ++dim) {
+      apf::MeshEntity* ent;
+      apf::MeshIterator* it = mesh->begin(dim);
+      while ((ent = mesh->iterate(it)))
+        if (mesh->isOwned(ent))
+          add_prolongation_row(P, this, base, ent, ent);
+      mesh->end(it);
+    }
+  }
+  else {
+    size_t idx = 0;
+    apf::MeshEntity* vtx;
+    apf::MeshIterator* vertices = mesh->begin(0);
+    while ((vtx = mesh->iterate(vertices))) {
+      auto base_ent = parents[idx++];
+      if (mesh->isOwned(vtx))
+        add_prolongation_row(P, this, base, vtx, base_ent);
+    }
+    mesh->end(vertices);
+  }
+  P->fillComplete(base->get_owned_map(), owned_map);
+  return P;
+}
+
+static std::vector<double> get_signature(apf::Mesh* m) {
+  int dim = m->getDimension();
+  std::vector<double> s(dim + 2, 0.0);
+  for (int d = 0; d <= dim; ++d)
+    s[d] = m->count(d);
+  apf::Vector3 x;
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = m->begin(0);
+  while ((vtx = m->iterate(vertices))) {
+    m->getPoint(vtx, 0, x);
+    s[dim + 1] += x[0] + x[1] + x[2];
+  }
+  m->end(vertices);
+  return s;
+}
+
+void Nested::compute_signature() {
+  signature = get_signature(base_mesh);
+}
+
+bool Nested::is_stale(Disc* base) {
+  int same = (base->get_apf_mesh() == base_mesh);
+  if (same) same = (get_signature(base_mesh) == signature);
+  same = PCU_Min_Int(same);
+  return ! same;
+}
+
+void Nested::transfer_soln() {
+  auto base_u = base_mesh->findField("u");
+  if (mode == QUADRATIC)
+    return apf::projectField(base_mesh->findField("u2"), base_u);
+  auto u = mesh->findField("u");
+  GOAL_DEBUG_ASSERT(base_u);
+  GOAL_DEBUG_ASSERT(u);
+  apf::Downward verts;
+  size_t idx = 0;
   apf::MeshEntity* vtx;
   apf::MeshIterator* vertices = mesh->begin(0);
   while ((vtx = mesh->iterate(vertices))) {
-    auto nmbr = apf::getNumber(nested_nmbr, vtx, 0);
-    auto base_ent = map[nmbr];
-    apf::getVector(nested_zu, vtx, 0, zdisp);
-    zpress = apf::getScalar(nested_zp, vtx, 0);
-    apf::setVector(zu_fine, base_ent, 0, zdisp);
-    apf::setScalar(zp_fine, base_ent, 0, zpress);
+    auto base_ent = parents[idx++];
+    int nverts = 1;
+    verts[0] = base_ent;
+    if (base_mesh->getType(base_ent) != apf::Mesh::VERTEX)
+      nverts = base_mesh->getDownward(base_ent, 0, verts);
+    double val = 0.0;
+    for (int v = 0; v < nverts; ++v)
+      val += apf::getScalar(base_u, verts[v], 0);
+    apf::setScalar(u, vtx, 0, val / nverts);
   }
   mesh->end(vertices);
-  apf::projectField(zu, zu_fine);
-  apf::projectField(zp, zp_fine);
+}
+
+static apf::Field* make_frozen_field(
+    apf::Mesh* m,
+    const char* name,
+    apf::FieldShape* s) {
+  auto f = apf::createField(m, name, apf::SCALAR, s);
+  apf::zeroField(f);
+  apf::freeze(f);
+  return f;
+}
+
+void Nested::create_adjoint_fields() {
+  auto P2 = apf::getSerendipity();
+  z_fine = make_frozen_field(base_mesh, "z_fine", P2);
+  z_coarse = make_frozen_field(base_mesh, "z", base_mesh->getShape());
+}
+
+void Nested::release_adjoint_fields() {
+  if (z_fine) apf::destroyField(z_fine);
+  if (z_coarse) apf::destroyField(z_coarse);
+  z_fine = 0;
+  z_coarse = 0;
+}
+
+void Nested::transfer_adjoint(apf::Field* z) {
+  GOAL_DEBUG_ASSERT(apf::getMesh(z) == mesh);
+  GOAL_DEBUG_ASSERT(apf::isFrozen(z));
+  if (! z_fine) create_adjoint_fields();
+  const double* zn = apf::getArrayData(z);
+  double* zf = apf::getArrayData(z_fine);
+  double* zc = apf::getArrayData(z_coarse);
+  size_t nverts = base_mesh->count(0);
+  size_t nedges = base_mesh->count(1);
+  if (mode == QUADRATIC) {
+    std::copy(zn, zn + nverts + nedges, zf);
+  }
+  else {
+    for (size_t i = 0; i < vtx_links.size(); i += 2)
+      zf[vtx_links[i + 1]] = zn[vtx_links[i]];
+    for (size_t e = 0; e < nedges; ++e)
+      zf[nverts + e] = 0.5 * (zf[edge_verts[2*e]] + zf[edge_verts[2*e + 1]]);
+    for (size_t i = 0; i < edge_links.size(); i += 2)
+      zf[edge_links[i + 1]] = zn[edge_links[i]];
+  }
+  std::copy(zf, zf + nverts, zc);
 }
 
 void Nested::create_base_map() {
   auto s = apf::getSerendipity();
-  base_ve_nmbr = apf::makeGlobal(
-      apf::numberOwnedNodes(base_mesh, "nve", s));
-  apf::synchronize(base_ve_nmbr);
+  base_ve_nmbr = apf::createGlobalNumbering(base_mesh, "nve", s);
+  base_ents.reserve(base_mesh->count(0) + base_mesh->count(1));
   for (int dim = 0; dim <= 1; ++dim) {
     apf::MeshEntity* ent;
     apf::MeshIterator* it = base_mesh->begin(dim);
-    while ((ent = base_mesh->iterate(it)))
-      map[ apf::getNumber(base_ve_nmbr, ent, 0) ] = ent;
+    while ((ent = base_mesh->iterate(it))) {
+      apf::number(base_ve_nmbr, ent, 0, base_ents.size());
+      base_ents.push_back(ent);
+    }
     base_mesh->end(it);
   }
+  apf::Downward verts;
+  edge_verts.resize(2 * base_mesh->count(1));
+  for (size_t e = 0; e < base_mesh->count(1); ++e) {
+    base_mesh->getDownward(base_ents[base_mesh->count(0) + e], 0, verts);
+    edge_verts[2*e] = apf::getNumber(base_ve_nmbr, verts[0], 0);
+    edge_verts[2*e + 1] = apf::getNumber(base_ve_nmbr, verts[1], 0);
+  }
 }
 
 void Nested::create_nested_mesh() {
   auto model = base_mesh->getModel();
   mesh = apf::createMdsMesh(model, base_mesh);
   apf::disownMdsModel(mesh);
-  nested_ve_nmbr = mesh->findGlobalNumbering("nve_global");
+  auto base_nmbr = mesh->findGlobalNumbering("nmbr");
+  if (base_nmbr) apf::destroyGlobalNumbering(base_nmbr);
+  nested_ve_nmbr = mesh->findGlobalNumbering("nve");
   GOAL_DEBUG_ASSERT(nested_ve_nmbr);
   apf::destroyGlobalNumbering(base_ve_nmbr);
   base_ve_nmbr = 0;
@@ -147,151 +323,6 @@ void NmbrTransfer::onVertex(
   apf::number(nmbr, vtx, 0, gid);
 }
 
-struct LongRefiner : public ma::IdentitySizeField {
-  LongRefiner(apf::Mesh2* m);
-  bool shouldSplit(apf::MeshEntity* edge);
-  void indicate_edges();
-  void gather_edges();
-  void mark_edges();
-  int dim;
-  apf::Mesh2* mesh;
-  apf::Field* marks;
-  std::set<apf::MeshEntity*> stored;
-};
-
-LongRefiner::LongRefiner(apf::Mesh2* m) :
-    ma::IdentitySizeField(m) {
-  mesh = m;
-  dim = mesh->getDimension();
-  mark_edges();
-}
-
-bool LongRefiner::shouldSplit(apf::MeshEntity* edge) {
-  if (stored.count(edge)) return true;
-  else return false;
-}
-
-static apf::MeshEntity* find_max_edge(
-    apf::Mesh* m, apf::MeshEntity* elem) {
-  apf::MeshEntity* max = 0;
-  apf::Downward edges;
-  int nedges = m->getDownward(elem, 1, edges);
-  for (int i = 0; i < nedges-1; ++i) {
-    if (apf::measure(m, edges[i]) > apf::measure(m, edges[i+1]))
-      max = edges[i];
-    else
-      max = edges[i+1];
-  }
-  return max;
-}
-
-void LongRefiner::indicate_edges() {
-  apf::MeshEntity* elem;
-  apf::MeshIterator* elems = mesh->begin(dim);
-  while ((elem = mesh->iterate(elems))) {
-    auto edge = find_max_edge(mesh, elem);
-    apf::setScalar(marks, edge, 0, 1.0);
-  }
-  mesh->end(elems);
-  apf::accumulate(marks);
-}
-
-void LongRefiner::gather_edges() {
-  apf::MeshEntity* edge;
-  apf::MeshIterator* edges = mesh->begin(1);
-  while ((edge = mesh->iterate(edges)))
-    if (apf::getScalar(marks, edge, 0) > 0)
-      stored.insert(edge);
-  mesh->end(edges);
-}
-
-void LongRefiner::mark_edges() {
-  auto s = apf::getConstant(1);
-  marks = apf::createField(mesh, "mark", apf::SCALAR, s);
-  apf::zeroField(marks);
-  indicate_edges();
-  gather_edges();
-  apf::destroyField(marks);
-}
-
-struct SingleRefiner : public ma::IdentitySizeField {
-  SingleRefiner(apf::Mesh2* m);
-  bool shouldSplit(apf::MeshEntity* edge);
-  void mark_edge(apf::MeshEntity* edge);
-  bool needs_marking(apf::Adjacent& elems);
-  void indicate_edges();
-  void gather_edges();
-  void mark_edges();
-  int dim;
-  apf::Mesh2* mesh;
-  apf::Field* edge_mark;
-  apf::Field* elem_mark;
-  std::set<apf::MeshEntity*> stored;
-};
-
-SingleRefiner::SingleRefiner(apf::Mesh2* m) :
-    ma::IdentitySizeField(m) {
-  mesh = m;
-  dim = mesh->getDimension();
-  mark_edges();
-}
-
-bool SingleRefiner::shouldSplit(apf::MeshEntity* edge) {
-  if (stored.count(edge)) return true;
-  else return false;
-}
-
-void SingleRefiner::mark_edge(apf::MeshEntity* edge) {
-  apf::setScalar(edge_mark, edge, 0, 1.0);
-  apf::Adjacent elems;
-  mesh->getAdjacent(edge, dim, elems);
-  for (size_t i = 0; i < elems.getSize(); ++i)
-    apf::setScalar(elem_mark, elems[i], 0, 1.0);
-}
-
-bool SingleRefiner::needs_marking(apf::Adjacent& elems) {
-  bool mark = true;
-  for (size_t i = 0; i < elems.getSize(); ++i)
-    if (apf::getScalar(elem_mark, elems[i], 0) > 0)
-      mark = false;
-  return mark;
-}
-
-void SingleRefiner::indicate_edges() {
-  apf::Adjacent elems;
-  apf::MeshEntity* edge;
-  apf::MeshIterator* edges = mesh->begin(1);
-  while ((edge = mesh->iterate(edges))) {
-    mesh->getAdjacent(edge, dim, elems);
-    if (needs_marking(elems))
-      mark_edge(edge);
-  }
-  mesh->end(edges);
-  apf::accumulate(edge_mark);
-}
-
-void SingleRefiner::gather_edges() {
-  apf::MeshEntity* edge;
-  apf::MeshIterator* edges = mesh->begin(1);
-  while ((edge = mesh->iterate(edges)))
-    if (apf::getScalar(edge_mark, edge, 0) > 0)
-      stored.insert(edge);
-  mesh->end(edges);
-}
-
-void SingleRefiner::mark_edges() {
-  apf::FieldShape* sedge = apf::getConstant(1);
-  apf::FieldShape* selem = apf::getConstant(dim);
-  edge_mark = apf::createField(mesh, "edge_mark", apf::SCALAR, sedge);
-  elem_mark = apf::createField(mesh, "elem_mark", apf::SCALAR, selem);
-  apf::zeroField(edge_mark);
-  apf::zeroField(elem_mark);
-  indicate_edges();
-  gather_edges();
-  apf::destroyField(edge_mark);
-  apf::destroyField(elem_mark);
-}
-
 void Nested::refine_uniform() {
   goal::print(" > nested: full");
   ma::AutoSolutionTransfer trans(mesh);
@@ -303,26 +334,38 @@ void Nested::refine_uniform() {
   ma::adapt(in);
 }
 
-void Nested::refine_long() {
-  goal::print(" > nested: long");
-  auto size = new LongRefiner(mesh);
-  auto in = ma::configureIdentity(mesh, size);
+void Nested::mark_edges() {
+  EdgeMarker marker = 0;
+  if (mode == LONG) marker = mark_long_edges;
+  if (mode == SINGLE) marker = mark_single_edges;
+  if (! marker) return;
+  marks = create_edge_marks(mesh);
+  marker(mesh, marks);
+  marks->synchronize();
+}
+
+void Nested::refine_marked() {
+  GOAL_DEBUG_ASSERT(marks);
+  ma::AutoSolutionTransfer trans(mesh);
+  auto nt = new NmbrTransfer(nested_ve_nmbr, nested_nmbr);
+  trans.add(nt);
+  auto in = ma::configureIdentity(mesh, marks, &trans);
   in->shouldFixShape = false;
   in->shouldSnap = false;
   in->maximumIterations = 1;
   ma::adapt(in);
-  delete size;
+  destroy_edge_marks(marks);
+  marks = 0;
+}
+
+void Nested::refine_long() {
+  goal::print(" > nested: long");
+  refine_marked();
 }
 
 void Nested::refine_single() {
   goal::print(" > nested: single");
-  auto size = new SingleRefiner(mesh);
-  auto in = ma::configureIdentity(mesh, size);
-  in->shouldFixShape = false;
-  in->shouldSnap = false;
-  in->maximumIterations = 1;
-  ma::adapt(in);
-  delete size;
+  refine_marked();
 }
 
 void Nested::refine_mesh() {
@@ -332,12 +375,41 @@ void Nested::refine_mesh() {
   else fail("unknown refine mode: %d", mode);
   apf::destroyGlobalNumbering(nested_ve_nmbr);
   apf::reorderMdsMesh(mesh);
-  mesh->verify();
+  if (verify == VERIFY_FULL) mesh->verify();
   nested_ve_nmbr = 0;
 }
 
-Nested* create_nested(Disc* d, const int mode) {
-  return new Nested(d, mode);
+void Nested::compute_parents() {
+  parents.resize(mesh->count(0));
+  long nverts = base_mesh->count(0);
+  int idx = 0;
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = mesh->begin(0);
+  while ((vtx = mesh->iterate(vertices))) {
+    long b = apf::getNumber(nested_nmbr, vtx, 0);
+    auto& links = (b < nverts) ? vtx_links : edge_links;
+    links.push_back(idx);
+    links.push_back(b);
+    parents[idx++] = base_ents[b];
+  }
+  mesh->end(vertices);
+  apf::destroyGlobalNumbering(nested_nmbr);
+  nested_nmbr = 0;
+  base_ents.clear();
+  base_ents.shrink_to_fit();
+}
+
+Nested* create_nested(Disc* d, const int mode, const bool balance) {
+  double t0 = time();
+  auto n = new Nested(d, mode, balance);
+  n->refine();
+  double t1 = time();
+  print(" > nested mesh built in %f seconds", t1 - t0);
+  return n;
+}
+
+Nested* create_unrefined_nested(Disc* d, const int mode, RCP<const Comm> c) {
+  return new Nested(d, mode, false, c);
 }
 
 void destroy_nested(Nested* n) {
@@ -2,34 +2,61 @@
 #define goal_nested_hpp
 
 #include "goal_disc.hpp"
+#include "goal_mark.hpp"
 
 namespace goal {
 
-enum RefineMode { FULL, LONG, SINGLE };
+enum RefineMode { FULL, LONG, SINGLE, QUADRATIC };
 
 class Nested : public Disc {
   public:
-    Nested(Disc* d, const int mode);
+    Nested(
+        Disc* d,
+        const int mode,
+        const bool balance = false,
+        RCP<const Comm> c = Teuchos::null);
     ~Nested();
-    void set_adjoint(RCP<VectorT> z);
-    void transfer_adjoint();
+    void refine();
+    void transfer_adjoint(apf::Field* z);
+    apf::Field* get_adjoint_fine() { return z_fine; }
+    apf::Field* get_adjoint() { return z_coarse; }
+    void release_adjoint_fields();
+    void transfer_soln();
+    bool is_stale(Disc* base);
+    RCP<MatrixT> build_prolongation(Disc* base);
   private:
+    void balance_base(EdgeMarker marker);
+    void enrich_mesh();
     void create_base_map();
     void create_nested_mesh();
     void initialize_nested_nmbr();
+    void mark_edges();
     void refine_mesh();
     void refine_uniform();
+    void refine_marked();
     void refine_long();
     void refine_single();
+    void compute_parents();
+    void compute_signature();
+    void create_adjoint_fields();
     int mode;
+    EdgeMarks* marks;
     apf::Mesh2* base_mesh;
     apf::GlobalNumbering* base_ve_nmbr;
     apf::GlobalNumbering* nested_ve_nmbr;
     apf::GlobalNumbering* nested_nmbr;
-    std::map<GO, apf::MeshEntity*> map;
+    std::vector<apf::MeshEntity*> base_ents;
+    std::vector<apf::MeshEntity*> parents;
+    std::vector<int> vtx_links;
+    std::vector<int> edge_links;
+    std::vector<int> edge_verts;
+    apf::Field* z_fine;
+    apf::Field* z_coarse;
+    std::vector<double> signature;
 };
 
-Nested* create_nested(Disc* d, const int mode);
+Nested* create_nested(Disc* d, const int mode, const bool balance = false);
+Nested* create_unrefined_nested(Disc* d, const int mode, RCP<const Comm> c);
 void destroy_nested(Nested* n);
 
 }
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <apf.h>
+#include <apfAlbany.h>
+#include <apfMesh2.h>
+#include <PCU.h>
+#include <Teuchos_LAPACK.hpp>
+
+#include "goal_control.hpp"
+#include "goal_disc.hpp"
+#include "goal_patch.hpp"
+
+namespace goal {
+
+using Teuchos::Array;
+using Teuchos::getValue;
+
+enum { MAX_TERMS = 10, FIT_SIZE = MAX_TERMS + 2 };
+
+static int get_num_terms(const int dim, const int order) {
+  if (order == 0) return 1;
+  if (order == 1) return dim + 1;
+  return (dim + 1) * (dim + 2) / 2;
+}
+
+static void eval_terms(
+    const int dim,
+    const int num_terms,
+    apf::Vector3 const& d,
+    double* t) {
+  t[0] = 1.0;
+  if (num_terms == 1) return;
+  for (int i = 0; i < dim; ++i)
+    t[1 + i] = d[i];
+  if (num_terms == dim + 1) return;
+  int k = dim + 1;
+  for (int i = 0; i < dim; ++i)
+  for (int j = i; j < dim; ++j)
+    t[k++] = d[i] * d[j];
+}
+
+struct Sample {
+  double x[3];
+  double z;
+  bool operator<(Sample const& o) const {
+    return std::lexicographical_compare(x, x + 3, o.x, o.x + 3);
+  }
+  bool operator==(Sample const& o) const {
+    return std::equal(x, x + 3, o.x);
+  }
+};
+
+using Patch = std::vector<Sample>;
+using SharedPatches = std::map<apf::MeshEntity*, Patch>;
+
+static void get_patch(
+    apf::Mesh* m,
+    apf::Field* z,
+    apf::MeshEntity* vtx,
+    Patch& patch) {
+  apf::Adjacent elems;
+  apf::Downward verts;
+  std::set<apf::MeshEntity*> unique;
+  m->getAdjacent(vtx, m->getDimension(), elems);
+  for (size_t e = 0; e < elems.getSize(); ++e) {
+    int nverts = m->getDownward(elems[e], 0, verts);
+    for (int v = 0; v < nverts; ++v)
+      unique.insert(verts[v]);
+  }
+  patch.resize(unique.size());
+  apf::Vector3 x;
+  size_t i = 0;
+  for (auto v : unique) {
+    m->getPoint(v, 0, x);
+    x.toArray(patch[i].x);
+    patch[i++].z = apf::getScalar(z, v, 0);
+  }
+}
+
+/* a vertex on a part boundary only sees its local elements, so every
+   copy sends its partial patch to the others. each copy then fits over
+   the union, which is the patch a serial run would see. */
+
+static void share_patches(
+    apf::Mesh* m,
+    apf::Field* z,
+    SharedPatches& shared) {
+  PCU_Comm_Begin();
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = m->begin(0);
+  while ((vtx = m->iterate(vertices))) {
+    if (! m->isShared(vtx)) continue;
+    auto& patch = shared[vtx];
+    get_patch(m, z, vtx, patch);
+    int npts = patch.size();
+    apf::Copies remotes;
+    m->getRemotes(vtx, remotes);
+    APF_ITERATE(apf::Copies, remotes, it) {
+      PCU_COMM_PACK(it->first, it->second);
+      PCU_COMM_PACK(it->first, npts);
+      PCU_Comm_Pack(it->first, &patch[0], npts * sizeof(Sample));
+    }
+  }
+  m->end(vertices);
+  PCU_Comm_Send();
+  while (PCU_Comm_Receive()) {
+    apf::MeshEntity* remote;
+    int npts;
+    PCU_COMM_UNPACK(remote);
+    PCU_COMM_UNPACK(npts);
+    auto& patch = shared[remote];
+    size_t start = patch.size();
+    patch.resize(start + npts);
+    PCU_Comm_Unpack(&patch[start], npts * sizeof(Sample));
+  }
+  for (auto& sp : shared) {
+    auto& patch = sp.second;
+    std::sort(patch.begin(), patch.end());
+    patch.erase(std::unique(patch.begin(), patch.end()), patch.end());
+  }
+}
+
+static void fit_vertex(
+    apf::Mesh* m,
+    apf::MeshEntity* vtx,
+    Patch const& patch,
+    double* fit) {
+  int dim = m->getDimension();
+  int npts = patch.size();
+  int order = 2;
+  while (get_num_terms(dim, order) > npts) --order;
+  int nterms = get_num_terms(dim, order);
+  apf::Vector3 xv, x;
+  m->getPoint(vtx, 0, xv);
+  double h = 0.0;
+  for (int p = 0; p < npts; ++p) {
+    x.fromArray(patch[p].x);
+    h = std::max(h, (x - xv).getLength());
+  }
+  std::vector<double> A(npts * nterms);
+  std::vector<double> b(npts);
+  double t[MAX_TERMS];
+  for (int p = 0; p < npts; ++p) {
+    x.fromArray(patch[p].x);
+    eval_terms(dim, nterms, (x - xv) / h, t);
+    for (int j = 0; j < nterms; ++j)
+      A[j * npts + p] = t[j];
+    b[p] = patch[p].z;
+  }
+  int info = 0;
+  int lwork = -1;
+  double wsize = 0.0;
+  Teuchos::LAPACK<int, double> lapack;
+  lapack.GELS('N', npts, nterms, 1, &A[0], npts, &b[0], npts,
+      &wsize, lwork, &info);
+  lwork = int(wsize);
+  std::vector<double> work(lwork);
+  lapack.GELS('N', npts, nterms, 1, &A[0], npts, &b[0], npts,
+      &work[0], lwork, &info);
+  GOAL_ALWAYS_ASSERT_VERBOSE(info == 0, "patch recovery: GELS failed");
+  fit[0] = nterms;
+  fit[1] = h;
+  for (int j = 0; j < nterms; ++j)
+    fit[2 + j] = b[j];
+}
+
+static double eval_fit(
+    apf::Mesh* m,
+    apf::MeshTag* tag,
+    apf::MeshEntity* vtx,
+    apf::Vector3 const& x) {
+  double fit[FIT_SIZE];
+  double t[MAX_TERMS];
+  m->getDoubleTag(vtx, tag, fit);
+  int nterms = fit[0];
+  apf::Vector3 xv;
+  m->getPoint(vtx, 0, xv);
+  eval_terms(m->getDimension(), nterms, (x - xv) / fit[1], t);
+  double val = 0.0;
+  for (int j = 0; j < nterms; ++j)
+    val += fit[2 + j] * t[j];
+  return val;
+}
+
+static std::set<std::string> get_dbc_sets(ParameterList const& p) {
+  std::set<std::string> names;
+  for (auto it = p.begin(); it != p.end(); ++it) {
+    auto entry = p.entry(it);
+    if (! entry.isType<Array<std::string>>()) continue;
+    auto const& a = getValue<Array<std::string>>(entry);
+    names.insert(a[0]);
+  }
+  return names;
+}
+
+static bool is_dbc(
+    Disc* d,
+    std::set<std::string> const& names,
+    apf::MeshEntity* ent) {
+  auto m = d->get_apf_mesh();
+  auto sets = d->get_model_sets();
+  std::set<apf::StkModel*> mset;
+  apf::collectEntityModels(m, sets->invMaps[0], m->toModel(ent), mset);
+  for (auto ns : mset)
+    if (names.count(ns->stkName)) return true;
+  return false;
+}
+
+void recover_adjoint(
+    Disc* d,
+    ParameterList const& dbcs,
+    apf::Field* z,
+    apf::Field* z_fine) {
+  auto t0 = time();
+  auto m = d->get_apf_mesh();
+  auto fit_tag = m->createDoubleTag("goal_patch_fit", FIT_SIZE);
+  auto dbc_sets = get_dbc_sets(dbcs);
+  double fit[FIT_SIZE];
+  SharedPatches shared;
+  share_patches(m, z, shared);
+  Patch local;
+  apf::MeshEntity* vtx;
+  apf::MeshIterator* vertices = m->begin(0);
+  while ((vtx = m->iterate(vertices))) {
+    auto it = shared.find(vtx);
+    if (it == shared.end()) {
+      get_patch(m, z, vtx, local);
+      std::sort(local.begin(), local.end());
+    }
+    auto const& patch = (it == shared.end()) ? local : it->second;
+    fit_vertex(m, vtx, patch, fit);
+    m->setDoubleTag(vtx, fit_tag, fit);
+    double val = is_dbc(d, dbc_sets, vtx) ? 0.0 : fit[2];
+    apf::setScalar(z_fine, vtx, 0, val);
+  }
+  m->end(vertices);
+  apf::Vector3 xa, xb;
+  apf::Downward v;
+  apf::MeshEntity* edge;
+  apf::MeshIterator* edges = m->begin(1);
+  while ((edge = m->iterate(edges))) {
+    m->getDownward(edge, 0, v);
+    double val = 0.0;
+    if (! is_dbc(d, dbc_sets, edge)) {
+      m->getPoint(v[0], 0, xa);
+      m->getPoint(v[1], 0, xb);
+      auto xm = (xa + xb) * 0.5;
+      val = 0.5 * (eval_fit(m, fit_tag, v[0], xm) +
+                   eval_fit(m, fit_tag, v[1], xm));
+    }
+    apf::setScalar(z_fine, edge, 0, val);
+  }
+  m->end(edges);
+  apf::synchronize(z_fine);
+  apf::removeTagFromDimension(m, fit_tag, 0);
+  m->destroyTag(fit_tag);
+  auto t1 = time();
+  print(" > adjoint recovered in %f seconds", t1 - t0);
+}
+
+}
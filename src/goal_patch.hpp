@@ -0,0 +1,24 @@
+#ifndef goal_patch_hpp
+#define goal_patch_hpp
+
+#include <Teuchos_ParameterList.hpp>
+
+namespace apf {
+class Field;
+}
+
+namespace goal {
+
+class Disc;
+
+using Teuchos::ParameterList;
+
+void recover_adjoint(
+    Disc* d,
+    ParameterList const& dbcs,
+    apf::Field* z,
+    apf::Field* z_fine);
+
+}
+
+#endif
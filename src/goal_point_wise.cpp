@@ -44,7 +44,7 @@ void PointWise<T>::post_process(SolInfo* s) {
   }
   if (vtx && mesh->isOwned(vtx)) {
     GO row = this->disc->get_gid(vtx, 0, 0);
-    dMdu->replaceGlobalValue(row, 1.0);
+    dMdu->replaceGlobalValue(row, this->qoi_idx, 1.0);
     this->qoi_value = apf::getScalar(u, vtx, 0);
   }
   PCU_Add_Doubles(&(this->qoi_value), 1);
@@ -41,6 +41,12 @@ void Poisson::make_soln() {
     soln = apf::createFieldOn(m, "u", apf::SCALAR);
     apf::zeroField(soln);
   }
+  else if (disc->get_shape() != m->getShape()) {
+    auto u = m->findField("u");
+    GOAL_DEBUG_ASSERT(u);
+    soln = apf::createField(m, "u2", apf::SCALAR, disc->get_shape());
+    apf::projectField(soln, u);
+  }
   else {
     soln = m->findField("u");
     GOAL_DEBUG_ASSERT(soln);
@@ -57,7 +63,10 @@ void Poisson::build_resid(Evaluators& E) {
 }
 
 template <typename T>
-void Poisson::build_functional(ParameterList const& params, Evaluators& E) {
+void Poisson::build_functional(
+    ParameterList const& params,
+    Evaluators& E,
+    const int idx) {
   auto type = params.get<std::string>("type");
   auto u = find_evaluator("u", E);
   RCP<QoI<T>> J;
@@ -69,6 +78,7 @@ void Poisson::build_functional(ParameterList const& params, Evaluators& E) {
     J = rcp(new PointWise<T>(params));
   else
     fail("unknown functional type: %s", type.c_str());
+  J->set_qoi_index(idx);
   E.push_back(J);
 }
 
@@ -82,7 +92,9 @@ void destroy_poisson(Poisson* m) {
 
 template void Poisson::build_resid<ST>(Evaluators&);
 template void Poisson::build_resid<FADT>(Evaluators&);
-template void Poisson::build_functional<ST>(ParameterList const&, Evaluators&);
-template void Poisson::build_functional<FADT>(ParameterList const&, Evaluators&);
+template void Poisson::build_functional<ST>(
+    ParameterList const&, Evaluators&, const int);
+template void Poisson::build_functional<FADT>(
+    ParameterList const&, Evaluators&, const int);
 
 }
@@ -27,7 +27,10 @@ class Poisson {
     template <typename T>
     void build_resid(Evaluators& E);
     template <typename T>
-    void build_functional(ParameterList const& params, Evaluators& E);
+    void build_functional(
+        ParameterList const& params,
+        Evaluators& E,
+        const int idx = 0);
   private:
     void make_soln();
     ParameterList params;
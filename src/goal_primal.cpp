@@ -29,6 +29,8 @@ Primal::Primal(ParameterList const& p, Poisson* m) {
   params = p;
   poisson = m;
   sol_info = 0;
+  auto lp = params.sublist("primal linear algebra");
+  linear_solver = create_linear_solver(lp);
   make_soln(poisson, residual, jacobian);
   poisson->build_resid<ST>(residual);
   poisson->build_resid<FADT>(jacobian);
@@ -36,6 +38,7 @@ Primal::Primal(ParameterList const& p, Poisson* m) {
 
 Primal::~Primal() {
   destroy_data();
+  destroy_linear_solver(linear_solver);
 }
 
 void Primal::build_data() {
@@ -48,6 +51,7 @@ void Primal::destroy_data() {
     destroy_sol_info(sol_info);
     sol_info = 0;
   }
+  linear_solver->reset();
 }
 
 void Primal::print_banner(const double t_now) {
@@ -64,24 +68,33 @@ void Primal::compute_jacob(const double t_now, const double t_old) {
   set_time(jacobian, t_now, t_old);
   assemble(jacobian, sol_info);
   sol_info->gather_all();
-  set_jac_dbcs(dbc, sol_info, t_now);
+  set_jac_dbcs(dbc, sol_info, poisson->get_soln(), t_now);
   sol_info->complete_fill();
   auto t1 = time();
   print(" > jacobian computed in %f seconds", t1 - t0);
 }
 
-void Primal::solve(const double t_now, const double t_old) {
+void Primal::solve_system(const double t_now, const double t_old) {
   print_banner(t_now);
   auto disc = sol_info->get_disc();
   auto R = sol_info->owned->R;
   auto dRdu = sol_info->owned->dRdu;
-  auto du = rcp(new VectorT(disc->get_owned_map()));
-  auto lp = params.sublist("primal linear algebra");
+  du = rcp(new VectorT(disc->get_owned_map()));
   compute_jacob(t_now, t_old);
   R->scale(-1.0);
   du->putScalar(0.0);
-  goal::solve(lp, dRdu, du, R, disc);
+  linear_solver->solve(dRdu, du, R, disc);
+}
+
+void Primal::update_soln() {
+  auto disc = sol_info->get_disc();
   disc->add_soln(du);
+  du = Teuchos::null;
+}
+
+void Primal::solve(const double t_now, const double t_old) {
+  solve_system(t_now, t_old);
+  update_soln();
 }
 
 Primal* create_primal(ParameterList const& p, Poisson* m) {
@@ -3,9 +3,12 @@
 
 #include <Teuchos_ParameterList.hpp>
 
+#include "goal_data_types.hpp"
+
 namespace goal {
 
 class Integrator;
+class LinearSolver;
 class Poisson;
 class SolInfo;
 
@@ -22,12 +25,16 @@ class Primal {
     void build_data();
     void destroy_data();
     void solve(const double t_now, const double t_old);
+    void solve_system(const double t_now, const double t_old);
+    void update_soln();
   private:
     void print_banner(const double t_now);
     void compute_jacob(const double t_now, const double t_old);
     ParameterList params;
     Poisson* poisson;
     SolInfo* sol_info;
+    LinearSolver* linear_solver;
+    RCP<VectorT> du;
     Evaluators residual;
     Evaluators jacobian;
 };
@@ -10,6 +10,7 @@ namespace goal {
 QoI<ST>::QoI() :
     elem(0),
     disc(0),
+    qoi_idx(0),
     qoi_value(0.0),
     elem_value(0.0) {
 }
@@ -40,6 +41,7 @@ void QoI<ST>::post_process(SolInfo*) {
 QoI<FADT>::QoI() :
     elem(0),
     disc(0),
+    qoi_idx(0),
     qoi_value(0.0),
     elem_value(0.0) {
 }
@@ -69,7 +71,7 @@ void QoI<FADT>::scatter(SolInfo* s) {
   for (int dof = 0; dof < num_dofs; ++dof) {
     GO row = rows[dof];
     auto val = get_elem_value().fastAccessDx(dof);
-    dMdu->sumIntoGlobalValue(row, val);
+    dMdu->sumIntoGlobalValue(row, qoi_idx, val);
   }
   qoi_value += elem_value.val();
   elem = 0;
@@ -16,6 +16,8 @@ class QoI<ST> : public Integrator {
     virtual ~QoI();
     ST const& get_qoi_value() const { return qoi_value; }
     ST const& get_elem_value() const { return elem_value; }
+    int get_qoi_index() const { return qoi_idx; }
+    void set_qoi_index(const int i) { qoi_idx = i; }
     virtual void set_time(const double, const double) {}
     virtual void set_elem_set(const int) {}
     virtual void pre_process(SolInfo*);
@@ -28,6 +30,7 @@ class QoI<ST> : public Integrator {
   protected:
     apf::MeshElement* elem;
     Disc* disc;
+    int qoi_idx;
     ST qoi_value;
     ST elem_value;
 };
@@ -39,6 +42,8 @@ class QoI<FADT> : public Integrator {
     virtual ~QoI();
     ST const& get_qoi_value() const { return qoi_value; }
     FADT const& get_elem_value() const { return elem_value; }
+    int get_qoi_index() const { return qoi_idx; }
+    void set_qoi_index(const int i) { qoi_idx = i; }
     virtual void set_time(const double, const double) {}
     virtual void set_elem_set(const int) {}
     virtual void pre_process(SolInfo* s);
@@ -51,6 +56,7 @@ class QoI<FADT> : public Integrator {
   protected:
     apf::MeshElement* elem;
     Disc* disc;
+    int qoi_idx;
     ST qoi_value;
     FADT elem_value;
 };
@@ -0,0 +1,288 @@
+#include <apf.h>
+#include <apfAlbany.h>
+#include <apfMesh.h>
+#include <apfNumbering.h>
+#include <apfShape.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <PCU.h>
+
+#include "goal_control.hpp"
+#include "goal_snapshot.hpp"
+
+namespace goal {
+
+static const long magic = 0x70616e73616f67;
+
+static std::string get_file_name(std::string const& prefix) {
+  return prefix + "_" + std::to_string(PCU_Comm_Self()) + ".gsnap";
+}
+
+std::string get_snapshot_mesh(std::string const& prefix) {
+  return prefix + ".smb";
+}
+
+static bool is_current(std::string const& name, std::string const& key) {
+  std::ifstream f(name.c_str(), std::ios::binary);
+  long count = 0;
+  long header = 0;
+  f.read((char*)&count, sizeof(long));
+  f.read((char*)&header, sizeof(long));
+  if (! f || count != 1 || header != magic) return false;
+  f.read((char*)&count, sizeof(long));
+  if (! f || count != long(key.size())) return false;
+  std::string stored(count, '\0');
+  f.read(&stored[0], count);
+  return f && (stored == key);
+}
+
+bool has_snapshot(std::string const& prefix, std::string const& key) {
+  auto name = get_file_name(prefix);
+  std::ifstream f(name.c_str());
+  int exists = PCU_Max_Int(f.good());
+  int current = PCU_Min_Int(is_current(name, key));
+  if (exists && ! current)
+    print("snapshot %s does not match the inputs, rebuilding",
+        prefix.c_str());
+  return current;
+}
+
+template <typename F>
+static void visit_nodes(apf::Mesh* m, apf::FieldShape* s, F f) {
+  apf::MeshEntity* ent;
+  for (int dim = 0; dim <= m->getDimension(); ++dim) {
+    if (! s->hasNodesIn(dim)) continue;
+    apf::MeshIterator* it = m->begin(dim);
+    while ((ent = m->iterate(it))) {
+      int nnodes = s->countNodesOn(m->getType(ent));
+      for (int n = 0; n < nnodes; ++n)
+        f(apf::Node(ent, n));
+    }
+    m->end(it);
+  }
+}
+
+class Writer {
+  public:
+    Writer(std::string const& name) : out(name, std::ios::binary) {
+      if (! out.good()) fail("cannot open file: %s", name.c_str());
+    }
+    template <typename T>
+    void write(const T* vals, const size_t n) {
+      long count = n;
+      out.write((const char*)&count, sizeof(long));
+      out.write((const char*)vals, n * sizeof(T));
+      static const char zeros[8] = {0};
+      size_t pad = (8 - (n * sizeof(T)) % 8) % 8;
+      out.write(zeros, pad);
+    }
+    template <typename T>
+    void write(std::vector<T> const& vals) {
+      write(vals.data(), vals.size());
+    }
+  private:
+    std::ofstream out;
+};
+
+class Reader {
+  public:
+    Reader(const void* d, const size_t s) :
+      data((const char*)d), size(s), pos(0) {}
+    template <typename T>
+    ArrayView<const T> read() {
+      if (pos + sizeof(long) > size) fail("truncated snapshot");
+      long count = *(const long*)(data + pos);
+      pos += sizeof(long);
+      auto vals = (const T*)(data + pos);
+      size_t bytes = count * sizeof(T);
+      if (pos + bytes > size) fail("truncated snapshot");
+      pos += bytes + (8 - bytes % 8) % 8;
+      return ArrayView<const T>(vals, count);
+    }
+  private:
+    const char* data;
+    size_t size;
+    size_t pos;
+};
+
+static std::vector<int> pack_sets(apf::Mesh* m, apf::StkModels* sets) {
+  std::vector<int> s;
+  auto d = m->getDimension();
+  int dims[3] = {0, d - 1, d};
+  for (int sdi = 0; sdi < 3; ++sdi)
+  for (size_t i = 0; i < sets->models[dims[sdi]].size(); ++i) {
+    auto set = sets->models[dims[sdi]][i];
+    s.push_back(sdi);
+    s.push_back(set->stkName.size());
+    s.push_back(set->ents.size());
+    for (size_t c = 0; c < set->stkName.size(); ++c)
+      s.push_back(set->stkName[c]);
+    for (size_t e = 0; e < set->ents.size(); ++e) {
+      s.push_back(m->getModelType(set->ents[e]));
+      s.push_back(m->getModelTag(set->ents[e]));
+    }
+  }
+  return s;
+}
+
+static void pack_graph(
+    RCP<const GraphT> g,
+    std::vector<GO>& cols,
+    std::vector<size_t>& ptrs,
+    std::vector<LO>& idxs) {
+  auto col_map = g->getColMap();
+  auto gids = col_map->getNodeElementList();
+  cols.assign(gids.begin(), gids.end());
+  ptrs.assign(1, 0);
+  idxs.clear();
+  Teuchos::ArrayView<const LO> row_idxs;
+  for (LO row = 0; row < LO(g->getNodeNumRows()); ++row) {
+    g->getLocalRowView(row, row_idxs);
+    idxs.insert(idxs.end(), row_idxs.begin(), row_idxs.end());
+    ptrs.push_back(idxs.size());
+  }
+}
+
+void write_snapshot(
+    std::string const& prefix,
+    std::string const& key,
+    apf::Mesh* m,
+    apf::StkModels* sets,
+    apf::GlobalNumbering* n,
+    RCP<const MapT> node_map,
+    RCP<const MapT> owned_map,
+    RCP<const MapT> ghost_map,
+    RCP<const GraphT> owned_graph,
+    RCP<const GraphT> ghost_graph) {
+  auto t0 = time();
+  Writer w(get_file_name(prefix));
+  auto s = apf::getShape(n);
+  std::string shape_name = s->getName();
+  w.write(&magic, 1);
+  w.write(key.data(), key.size());
+  w.write(shape_name.data(), shape_name.size());
+  w.write(pack_sets(m, sets));
+  std::vector<GO> nodes;
+  visit_nodes(m, s, [&] (apf::Node const& node) {
+    nodes.push_back(apf::getNumber(n, node));
+  });
+  w.write(nodes);
+  auto owned_nodes = node_map->getNodeElementList();
+  auto owned_dofs = owned_map->getNodeElementList();
+  auto ghost_dofs = ghost_map->getNodeElementList();
+  w.write(owned_nodes.getRawPtr(), owned_nodes.size());
+  w.write(owned_dofs.getRawPtr(), owned_dofs.size());
+  w.write(ghost_dofs.getRawPtr(), ghost_dofs.size());
+  std::vector<GO> cols;
+  std::vector<size_t> ptrs;
+  std::vector<LO> idxs;
+  RCP<const GraphT> graphs[2] = {owned_graph, ghost_graph};
+  for (int i = 0; i < 2; ++i) {
+    pack_graph(graphs[i], cols, ptrs, idxs);
+    w.write(cols);
+    w.write(ptrs);
+    w.write(idxs);
+  }
+  auto t1 = time();
+  print(" > snapshot written in %f seconds", t1 - t0);
+}
+
+Snapshot::Snapshot(std::string const& prefix, std::string const& key) {
+  auto name = get_file_name(prefix);
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) fail("cannot open file: %s", name.c_str());
+  struct stat st;
+  fstat(fd, &st);
+  size = st.st_size;
+  data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) fail("cannot map file: %s", name.c_str());
+  Reader r(data, size);
+  auto header = r.read<long>();
+  if (header.size() != 1 || header[0] != magic)
+    fail("invalid snapshot: %s", name.c_str());
+  auto stored_key = r.read<char>();
+  if (std::string(stored_key.begin(), stored_key.end()) != key)
+    fail("snapshot does not match the inputs: %s", name.c_str());
+  auto stored_shape = r.read<char>();
+  shape_name.assign(stored_shape.begin(), stored_shape.end());
+  sets = r.read<int>();
+  nodes = r.read<GO>();
+  owned_nodes = r.read<GO>();
+  owned_dofs = r.read<GO>();
+  ghost_dofs = r.read<GO>();
+  for (int i = 0; i < 2; ++i) {
+    col_gids[i] = r.read<GO>();
+    row_ptrs[i] = r.read<size_t>();
+    col_idxs[i] = r.read<LO>();
+  }
+}
+
+Snapshot::~Snapshot() {
+  munmap(data, size);
+}
+
+apf::StkModels* Snapshot::get_sets(apf::Mesh* m) {
+  auto models = new apf::StkModels;
+  auto d = m->getDimension();
+  int dims[3] = {0, d - 1, d};
+  size_t k = 0;
+  while (k < size_t(sets.size())) {
+    int sdi = sets[k++];
+    int name_len = sets[k++];
+    int nents = sets[k++];
+    auto set = new apf::StkModel();
+    for (int c = 0; c < name_len; ++c)
+      set->stkName.push_back(char(sets[k++]));
+    for (int e = 0; e < nents; ++e) {
+      int mdim = sets[k++];
+      int mtag = sets[k++];
+      set->ents.push_back(m->findModelEntity(mdim, mtag));
+      if (! set->ents.back())
+        fail("no model entity with dim: %d and tag: %d", mdim, mtag);
+    }
+    models->models[dims[sdi]].push_back(set);
+  }
+  models->computeInverse();
+  return models;
+}
+
+apf::GlobalNumbering* Snapshot::get_numbering(
+    apf::Mesh* m,
+    const char* name,
+    apf::FieldShape* s) {
+  if (shape_name != s->getName())
+    fail("snapshot shape %s does not match %s",
+        shape_name.c_str(), s->getName());
+  auto n = apf::createGlobalNumbering(m, name, s);
+  size_t k = 0;
+  visit_nodes(m, s, [&] (apf::Node const& node) {
+    GOAL_ALWAYS_ASSERT(k < size_t(nodes.size()));
+    apf::number(n, node, nodes[k++]);
+  });
+  GOAL_ALWAYS_ASSERT(k == size_t(nodes.size()));
+  return n;
+}
+
+RCP<GraphT> Snapshot::get_graph(
+    const int which,
+    RCP<const MapT> row_map,
+    RCP<const Comm> comm) {
+  auto col_map = Tpetra::createNonContigMap<LO, GO>(col_gids[which], comm);
+  auto ptrs = row_ptrs[which];
+  auto idxs = col_idxs[which];
+  GOAL_ALWAYS_ASSERT(size_t(ptrs.size()) == row_map->getNodeNumElements() + 1);
+  Teuchos::ArrayRCP<size_t> row_ptr(ptrs.size());
+  Teuchos::ArrayRCP<LO> col_idx(idxs.size());
+  std::copy(ptrs.begin(), ptrs.end(), row_ptr.begin());
+  std::copy(idxs.begin(), idxs.end(), col_idx.begin());
+  auto g = Teuchos::rcp(new GraphT(row_map, col_map, row_ptr, col_idx));
+  g->expertStaticFillComplete(row_map, row_map);
+  return g;
+}
+
+}
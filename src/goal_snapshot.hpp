@@ -0,0 +1,69 @@
+#ifndef goal_snapshot_hpp
+#define goal_snapshot_hpp
+
+#include "goal_data_types.hpp"
+
+namespace apf {
+struct StkModels;
+class Mesh;
+class Mesh2;
+class FieldShape;
+template <class T> class NumberingOf;
+typedef NumberingOf<long> GlobalNumbering;
+}
+
+namespace goal {
+
+using Teuchos::RCP;
+using Teuchos::ArrayView;
+
+enum SnapshotGraph { OWNED_GRAPH, GHOST_GRAPH };
+
+class Snapshot {
+  public:
+    Snapshot(std::string const& prefix, std::string const& key);
+    ~Snapshot();
+    apf::StkModels* get_sets(apf::Mesh* m);
+    apf::GlobalNumbering* get_numbering(
+        apf::Mesh* m,
+        const char* name,
+        apf::FieldShape* s);
+    ArrayView<const GO> get_owned_nodes() { return owned_nodes; }
+    ArrayView<const GO> get_owned_dofs() { return owned_dofs; }
+    ArrayView<const GO> get_ghost_dofs() { return ghost_dofs; }
+    RCP<GraphT> get_graph(
+        const int which,
+        RCP<const MapT> row_map,
+        RCP<const Comm> comm);
+  private:
+    void* data;
+    size_t size;
+    std::string shape_name;
+    ArrayView<const int> sets;
+    ArrayView<const GO> nodes;
+    ArrayView<const GO> owned_nodes;
+    ArrayView<const GO> owned_dofs;
+    ArrayView<const GO> ghost_dofs;
+    ArrayView<const GO> col_gids[2];
+    ArrayView<const size_t> row_ptrs[2];
+    ArrayView<const LO> col_idxs[2];
+};
+
+bool has_snapshot(std::string const& prefix, std::string const& key);
+std::string get_snapshot_mesh(std::string const& prefix);
+
+void write_snapshot(
+    std::string const& prefix,
+    std::string const& key,
+    apf::Mesh* m,
+    apf::StkModels* sets,
+    apf::GlobalNumbering* n,
+    RCP<const MapT> node_map,
+    RCP<const MapT> owned_map,
+    RCP<const MapT> ghost_map,
+    RCP<const GraphT> owned_graph,
+    RCP<const GraphT> ghost_graph);
+
+}
+
+#endif
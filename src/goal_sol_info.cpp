@@ -3,8 +3,9 @@
 
 namespace goal {
 
-SolInfo::SolInfo(Disc* d) {
+SolInfo::SolInfo(Disc* d, const int nq) {
   disc = d;
+  num_qois = nq;
   owned = new LinearObj;
   ghost = new LinearObj;
   auto owned_map = disc->get_owned_map();
@@ -14,10 +15,10 @@ SolInfo::SolInfo(Disc* d) {
   importer = rcp(new ImportT(owned_map, ghost_map));
   exporter = rcp(new ExportT(ghost_map, owned_map));
   owned->R = rcp(new VectorT(owned_map));
-  owned->dMdu = rcp(new VectorT(owned_map));
+  owned->dMdu = rcp(new MultiVectorT(owned_map, num_qois));
   owned->dRdu = rcp(new MatrixT(owned_graph));
   ghost->R = rcp(new VectorT(ghost_map));
-  ghost->dMdu = rcp(new VectorT(ghost_map));
+  ghost->dMdu = rcp(new MultiVectorT(ghost_map, num_qois));
   ghost->dRdu = rcp(new MatrixT(ghost_graph));
 }
 
@@ -79,8 +80,8 @@ void SolInfo::complete_fill() {
   ghost->dRdu->fillComplete();
 }
 
-SolInfo* create_sol_info(Disc* d) {
-  return new SolInfo(d);
+SolInfo* create_sol_info(Disc* d, const int num_qois) {
+  return new SolInfo(d, num_qois);
 }
 
 void destroy_sol_info(SolInfo* s) {
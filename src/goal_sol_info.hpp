@@ -11,15 +11,16 @@ class Disc;
 
 struct LinearObj {
   RCP<VectorT> R;
-  RCP<VectorT> dMdu;
+  RCP<MultiVectorT> dMdu;
   RCP<MatrixT> dRdu;
 };
 
 class SolInfo {
   public:
-    SolInfo(Disc* d);
+    SolInfo(Disc* d, const int num_qois);
     ~SolInfo();
     Disc* get_disc();
+    int get_num_qois() const { return num_qois; }
     void gather_R();
     void gather_dMdu();
     void gather_dRdu();
@@ -34,11 +35,12 @@ class SolInfo {
     LinearObj* ghost;
   private:
     Disc* disc;
+    int num_qois;
     RCP<ImportT> importer;
     RCP<ExportT> exporter;
 };
 
-SolInfo* create_sol_info(Disc* d);
+SolInfo* create_sol_info(Disc* d, const int num_qois = 1);
 void destroy_sol_info(SolInfo* s);
 
 }
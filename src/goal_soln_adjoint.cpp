@@ -14,6 +14,9 @@ SolnAdjoint::SolnAdjoint(apf::Field* f, apf::Field* c) :
   GOAL_DEBUG_ASSERT(apf::getValueType(coarse) == apf::SCALAR);
   num_dims = apf::getMesh(coarse)->getDimension();
   num_nodes = 0;
+  coarse_elem = 0;
+  fine_elem = 0;
+  this->name = "uw";
 }
 
 ST const& SolnAdjoint::val(const int node) const {
@@ -55,6 +58,10 @@ void SolnAdjoint::at_point(apf::Vector3 const& p, double, double) {
 }
 
 void SolnAdjoint::out_elem() {
+  apf::destroyElement(coarse_elem);
+  apf::destroyElement(fine_elem);
+  coarse_elem = 0;
+  fine_elem = 0;
   elem = 0;
 }
 
@@ -1,5 +1,6 @@
 #include <Teuchos_YamlParameterListHelpers.hpp>
 
+#include "goal_adapt.hpp"
 #include "goal_adjoint.hpp"
 #include "goal_control.hpp"
 #include "goal_disc.hpp"
@@ -17,6 +18,9 @@ using Teuchos::ParameterList;
 static ParameterList get_valid_params() {
   ParameterList p;
   p.set<std::string>("adjoint mode", "");
+  p.set<std::string>("adjoint initial guess", "");
+  p.set<bool>("adjoint balance", false);
+  p.set<bool>("adjoint overlap", false);
   p.sublist("discretization");
   p.sublist("dirichlet bcs");
   p.sublist("poisson");
@@ -24,6 +28,7 @@ static ParameterList get_valid_params() {
   p.sublist("primal linear algebra");
   p.sublist("adjoint linear algebra");
   p.sublist("output");
+  p.sublist("adaptation");
   return p;
 }
 
@@ -39,6 +44,9 @@ class Solver {
     Primal* primal;
     Functional* functional;
     Output* output;
+    Adapt* adapt;
+    Adjoint* adjoint;
+    bool overlap;
 };
 
 Solver::Solver(const char* in) {
@@ -54,9 +62,18 @@ Solver::Solver(const char* in) {
   primal = create_primal(*params, poisson);
   functional = create_functional(*params, primal);
   output = create_output(out_params, disc);
+  overlap = false;
+  if (params->isParameter("adjoint overlap"))
+    overlap = params->get<bool>("adjoint overlap");
+  adapt = 0;
+  if (params->isSublist("adaptation"))
+    adapt = create_adapt(params->sublist("adaptation"), disc);
+  adjoint = create_adjoint(*params, primal);
 }
 
 Solver::~Solver() {
+  destroy_adjoint(adjoint);
+  if (adapt) destroy_adapt(adapt);
   destroy_output(output);
   destroy_functional(functional);
   destroy_primal(primal);
@@ -65,23 +82,38 @@ Solver::~Solver() {
 }
 
 void Solver::solve() {
-  disc->build_data();
-  primal->build_data();
-  primal->solve(0.0, 0.0);
-  functional->compute(0.0, 0.0);
-  functional->print_value();
-  primal->destroy_data();
-  disc->destroy_data();
-  auto adjoint = create_adjoint(*params, primal);
-  adjoint->solve(0.0, 0.0);
-  destroy_adjoint(adjoint);
-  output->write(0.0, 0);
+  for (int cycle = 0; ; ++cycle) {
+    disc->build_data();
+    primal->build_data();
+    if (overlap) {
+      adjoint->prepare();
+      primal->solve_system(0.0, 0.0);
+      adjoint->wait_nested();
+      primal->update_soln();
+    }
+    else {
+      primal->solve(0.0, 0.0);
+    }
+    functional->compute(0.0, 0.0);
+    functional->print_value();
+    primal->destroy_data();
+    disc->destroy_data();
+    auto error = adapt ? adapt->get_error_field() : 0;
+    if (! overlap) adjoint->prepare();
+    adjoint->solve(0.0, 0.0, error);
+    auto err = adjoint->get_error();
+    output->write(cycle, cycle);
+    if (! adapt) break;
+    if (adapt->is_done(cycle, err)) break;
+    adjoint->release_base();
+    adapt->adapt();
+  }
 }
 
 }
 
 int main(int argc, char** argv) {
-  goal::initialize();
+  goal::initialize(true, true, true, MPI_THREAD_MULTIPLE);
   GOAL_DEBUG_ASSERT(argc == 2);
   const char* in = argv[1];
   { goal::Solver solver(in);
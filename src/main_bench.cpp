@@ -0,0 +1,96 @@
+#include <fstream>
+#include <PCU.h>
+#include <Teuchos_YamlParameterListHelpers.hpp>
+
+#include "goal_control.hpp"
+#include "goal_linear_solve.hpp"
+
+namespace goal {
+
+using Teuchos::RCP;
+using Teuchos::rcp;
+using Teuchos::ParameterList;
+
+using MMReaderT = Tpetra::MatrixMarket::Reader<MatrixT>;
+
+class Bench {
+  public:
+    Bench(const char* prefix, const char* in);
+    void run();
+  private:
+    void read_system(std::string const& name);
+    void run_config(std::string const& name, ParameterList const& p);
+    RCP<ParameterList> configs;
+    RCP<MatrixT> A;
+    RCP<MultiVectorT> b;
+    RCP<MultiVectorT> coords;
+};
+
+Bench::Bench(const char* prefix, const char* in) {
+  read_system(prefix);
+  print("reading configurations: %s", in);
+  configs = rcp(new ParameterList);
+  Teuchos::updateParametersFromYamlFile(in, configs.ptr());
+  auto captured = std::string(prefix) + "_params.yaml";
+  std::ifstream f(captured);
+  if (! f.good()) return;
+  auto p = Teuchos::getParametersFromYamlFile(captured);
+  configs->set("captured", *p);
+}
+
+void Bench::read_system(std::string const& name) {
+  auto t0 = time();
+  auto comm = Tpetra::DefaultPlatform::getDefaultPlatform().getComm();
+  print("reading linear system: %s", name.c_str());
+  A = MMReaderT::readSparseFile(name + "_A.mm", comm);
+  auto map = A->getRangeMap();
+  b = MMReaderT::readDenseFile(name + "_b.mm", comm, map);
+  std::ifstream f(name + "_coords.mm");
+  if (f.good()) {
+    RCP<const MapT> cmap;
+    auto c = MMReaderT::readDenseFile(name + "_coords.mm", comm, cmap);
+    if (c->getGlobalLength() == A->getGlobalNumRows()) {
+      ImportT importer(c->getMap(), A->getRowMap());
+      coords = rcp(new MultiVectorT(A->getRowMap(), c->getNumVectors()));
+      coords->doImport(*c, importer, Tpetra::INSERT);
+    }
+  }
+  auto t1 = time();
+  print(" > num dofs: %zu", A->getGlobalNumRows());
+  print(" > num rhs: %zu", b->getNumVectors());
+  print(" > read in %f seconds", t1 - t0);
+}
+
+void Bench::run_config(std::string const& name, ParameterList const& p) {
+  print("*** configuration: %s", name.c_str());
+  double mem0 = PCU_GetMem();
+  auto solver = create_linear_solver(p);
+  auto x = rcp(new MultiVectorT(A->getDomainMap(), b->getNumVectors()));
+  solver->solve(A, x, b, coords);
+  double mem = PCU_GetMem() - mem0;
+  auto stats = solver->get_stats();
+  destroy_linear_solver(solver);
+  PCU_Max_Doubles(&mem, 1);
+  print("bench %s: setup %f solve %f total %f iters %d mem %f MB%s",
+      name.c_str(), stats.setup_time, stats.solve_time,
+      stats.setup_time + stats.solve_time, stats.iters, mem,
+      stats.converged ? "" : " (unconverged)");
+}
+
+void Bench::run() {
+  for (auto it = configs->begin(); it != configs->end(); ++it) {
+    auto name = configs->name(it);
+    if (! configs->isSublist(name)) continue;
+    run_config(name, configs->sublist(name));
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  goal::initialize();
+  GOAL_ALWAYS_ASSERT(argc == 3);
+  { goal::Bench bench(argv[1], argv[2]);
+    bench.run(); }
+  goal::finalize();
+}
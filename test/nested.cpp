@@ -1,3 +1,4 @@
+#include <cmath>
 #include <apfNumbering.h>
 #include <goal_control.hpp>
 #include <goal_nested.hpp>
@@ -69,6 +70,20 @@ static void check_node_indices(goal::Disc* d) {
     goal::print("node id: %lu", d->get_gid(nodes[0], eq));
 }
 
+static void check_prolongation(goal::Disc* d, goal::Nested* n) {
+  d->build_data();
+  auto P = n->build_prolongation(d);
+  goal::VectorT x(d->get_owned_map());
+  goal::VectorT y(n->get_owned_map());
+  x.putScalar(1.0);
+  P->apply(x, y);
+  goal::print("prolongation rows: %lu", P->getGlobalNumRows());
+  goal::print("prolongation cols: %lu", P->getGlobalNumCols());
+  GOAL_ALWAYS_ASSERT(std::abs(y.normInf() - 1.0) < 1.0e-14);
+  GOAL_ALWAYS_ASSERT(std::abs(y.norm1() - y.getGlobalLength()) < 1.0e-8);
+  d->destroy_data();
+}
+
 static void check_nested(goal::Disc* d) {
   d->build_data();
   check_sets(d);
@@ -91,11 +106,18 @@ int main(int argc, char** argv) {
   goal::print(" > check full");
   auto n1 = goal::create_nested(d, goal::FULL);
   test::check_nested(n1);
+  test::check_prolongation(d, n1);
   goal::destroy_nested(n1);
   goal::print(" > check long");
   auto n2 = goal::create_nested(d, goal::LONG);
   test::check_nested(n2);
+  test::check_prolongation(d, n2);
   goal::destroy_nested(n2);
+  goal::print(" > check quadratic");
+  auto n3 = goal::create_nested(d, goal::QUADRATIC);
+  test::check_nested(n3);
+  test::check_prolongation(d, n3);
+  goal::destroy_nested(n3);
   goal::destroy_disc(d);
   goal::finalize();
 }
@@ -0,0 +1,32 @@
+#include <goal_adjoint.hpp>
+#include <goal_control.hpp>
+#include <goal_disc.hpp>
+#include <goal_poisson.hpp>
+#include <goal_primal.hpp>
+#include <Teuchos_YamlParameterListHelpers.hpp>
+
+int main(int argc, char** argv) {
+  goal::initialize();
+  goal::print("unit test: nested reuse");
+  GOAL_ALWAYS_ASSERT(argc == 2);
+  auto p = Teuchos::getParametersFromYamlFile(argv[1]);
+  auto d = goal::create_disc(p->sublist("discretization"));
+  auto m = goal::create_poisson(p->sublist("poisson"), d);
+  auto primal = goal::create_primal(*p, m);
+  auto adjoint = goal::create_adjoint(*p, primal);
+  for (int i = 0; i < 2; ++i) {
+    d->build_data();
+    primal->build_data();
+    primal->solve(0.0, 0.0);
+    primal->destroy_data();
+    d->destroy_data();
+    adjoint->prepare();
+    adjoint->solve(0.0, 0.0);
+  }
+  GOAL_ALWAYS_ASSERT(adjoint->get_num_builds() == 1);
+  goal::destroy_adjoint(adjoint);
+  goal::destroy_primal(primal);
+  goal::destroy_poisson(m);
+  goal::destroy_disc(d);
+  goal::finalize();
+}
@@ -0,0 +1,54 @@
+#include <goal_control.hpp>
+#include <goal_disc.hpp>
+#include <PCU.h>
+#include <Teuchos_ParameterList.hpp>
+
+namespace test {
+
+static std::vector<long> get_summary(goal::Disc* d) {
+  d->build_data();
+  std::vector<long> s;
+  s.push_back(d->get_num_elem_sets());
+  s.push_back(d->get_num_side_sets());
+  s.push_back(d->get_num_node_sets());
+  for (int i = 0; i < d->get_num_elem_sets(); ++i)
+    s.push_back(d->get_elems(d->get_elem_set_name(i)).size());
+  for (int i = 0; i < d->get_num_side_sets(); ++i)
+    s.push_back(d->get_sides(d->get_side_set_name(i)).size());
+  for (int i = 0; i < d->get_num_node_sets(); ++i)
+    s.push_back(d->get_nodes(d->get_node_set_name(i)).size());
+  s.push_back(d->get_owned_map()->getGlobalNumElements());
+  s.push_back(d->get_ghost_map()->getGlobalNumElements());
+  s.push_back(d->get_owned_graph()->getGlobalNumEntries());
+  s.push_back(d->get_ghost_graph()->getGlobalNumEntries());
+  d->destroy_data();
+  return s;
+}
+
+static std::string get_prefix(std::string const& mesh_file) {
+  auto base = mesh_file.substr(mesh_file.rfind('/') + 1);
+  auto peers = std::to_string(PCU_Comm_Peers());
+  return "snapshot_" + base.substr(0, base.rfind('.')) + "_" + peers;
+}
+
+}
+
+int main(int argc, char** argv) {
+  goal::initialize();
+  goal::print("unit test: snapshot");
+  GOAL_ALWAYS_ASSERT(argc == 4);
+  Teuchos::ParameterList p;
+  p.set<std::string>("geom file", argv[1]);
+  p.set<std::string>("mesh file", argv[2]);
+  p.set<std::string>("assoc file", argv[3]);
+  p.set<std::string>("snapshot", test::get_prefix(argv[2]));
+  auto d = goal::create_disc(p);
+  auto written = test::get_summary(d);
+  goal::destroy_disc(d);
+  d = goal::create_disc(p);
+  GOAL_ALWAYS_ASSERT(d->is_restart());
+  auto restarted = test::get_summary(d);
+  goal::destroy_disc(d);
+  GOAL_ALWAYS_ASSERT(written == restarted);
+  goal::finalize();
+}